@@ -10,6 +10,20 @@
 #include "types.h"
 #include "defs.h"
 #include "lcd.h"
+#include "sevenseg.h"
+#include "timebase.h"
+#include "sched.h"
+#include "PressureTemp.h"
+#include "twi.h"
+#include "TEMT6000.h"
+#include "ws_ntf.h"
+#include "ws_rx.h"
+#include "ws_dispatch.h"
+#include "ws_clock.h"
+#include "ws_minmax.h"
+#include "i2c-driver.h"
+#include "sht1x-driver.h"
+#include "busplan.h"
 /* Code for single pin addressing */
 
 
@@ -26,38 +40,14 @@ typedef struct
 
 }io_reg;
  
-#define D0      ((volatile io_reg*)_SFR_MEM_ADDR(PORTA))->bit4
-#define D1      ((volatile io_reg*)_SFR_MEM_ADDR(PORTA))->bit5
 #define LIGHT      ((volatile io_reg*)_SFR_MEM_ADDR(PORTA))->bit2
  
-/* Code for 7 seg display */
-
-
-static unsigned  char SEVEN_SEG[] = {
-0x3F,
-0x06,
-0x5B,
-0x4F,
-0x66,
-0x6D,
-0x7D,
-0x07,
-0x7F,
-0x6F,
-0x77,
-0x7C,
-0x39,
-0x5E,
-0x79,
-0x71};
-int speed_limit()
+int speed_limit(uint16_t adc_result0)
  {
  uint16_t Condition;
  uint16_t Condition2;
- uint16_t adc_result0;
  Condition=250;
  Condition2=30;
- adc_result0 = adc_read(0);      // read adc value at PA0
 	 int speed;
 	 if ((adc_result0 <= Condition2))
 	 {
@@ -69,80 +59,171 @@ int speed_limit()
 	 speed =95;}
   return speed; // returns value stored in speed variable 	
  }	
+/* Task periods in ms */
+#define LIGHT_PERIOD    20
+#define LCD_PERIOD      250
+#define SENSOR_PERIOD   1
+#define DISPATCH_PERIOD 10
+
+/* Sensor ids within this node */
+#define BMP085_SENSOR_ID 0
+#define SHT1X_SENSOR_ID  1
+
+/* SHT1x resolution, SHT1X_RES_12_8 measures about 4 times faster */
+#define SHT1X_RESOLUTION SHT1X_RES_14_12
+
+/* Latest readings formatted for the LCD */
+static char int_buffer[10];
+static char altitudes[10];
+static char pressures[10];
+static char temperatures[10];
+
+static void bmp085_send(const busplan_bmp085_t *bmp)
+{
+	ws_sensor_bmp085_raw_t raw;
+	ws_sensor_bmp085_cal_t cal;
+	uint8_t sendCal;
+
+	// raw values go to the collector as a binary datagram, the
+	// calibration only after start-up or when the collector asks for it
+	sendCal = ws_ntf_cal_take(BMP085_SENSOR_ID);
+	ws_ntf_begin(WS_NODE_ID_MAIN_UNIT);
+	if(sendCal)
+	{
+		bmp085FillCal(&cal, BMP085_SENSOR_ID);
+		ws_ntf_add(WS_SENSOR_NTF_BMP085_CAL, &cal, sizeof(cal));
+	}
+	bmp085FillRaw(&raw, BMP085_SENSOR_ID);
+	ws_minmax_add(WS_MINMAX_INDOOR, bmp->temperature);
+	ws_ntf_add(WS_SENSOR_NTF_BMP085_RAW, &raw, sizeof(raw));
+	if(ws_ntf_send() != WS_NTF_OK && sendCal)
+		ws_ntf_cal_request(BMP085_SENSOR_ID);
+
+	ltoa(bmp->weather_diff, altitudes, 10);
+	ltoa(bmp->pressure, pressures, 10);
+	itoa(bmp->temperature, temperatures, 10);
+}
+
+static void sht1x_send(void)
+{
+	ws_sensor_sht1x_t sht;
+	int16_t temp;
+
+	sht1x_fill(&sht, SHT1X_SENSOR_ID);
+	temp = sht1x_calc_temperature(&sht);
+	ws_minmax_add(WS_MINMAX_OUTDOOR, (temp + (temp < 0 ? -5 : 5)) / 10);
+	ws_ntf_begin(WS_NODE_ID_MAIN_UNIT);
+	ws_ntf_add(WS_SENSOR_NTF_SHT1X, &sht, sizeof(sht));
+	ws_ntf_send();
+}
+
+// the SHT1x and BMP085 cycles run side by side, see busplan.c; also
+// released by the SHT1x pin change ISR when a conversion is ready
+static int8_t sensor_task_id;
+
+static void sht1x_ready(void)
+{
+	sched_signal(sensor_task_id);
+}
+
+void sensor_task(void)
+{
+	busplan_bmp085_t bmp;
+	uint8_t done;
+
+	// a batch of samples (if the collector asked for batches) may not wait past its deadline
+	ws_ntf_poll();
+	done = busplan_poll(&bmp);
+	if(done & BUSPLAN_BMP085)
+		bmp085_send(&bmp);
+	if(done & BUSPLAN_SHT1X)
+		sht1x_send();
+}
+
+void light_task(void)
+{
+	static int shown_speed = -1;
+	uint16_t adc_result0;
+	int speed;
+
+	// latest sample of PA0, the ADC ISR converts it every ms
+	adc_result0 = adc_read(0);
+	// the display only needs new digits when the speed changes
+	speed = speed_limit(adc_result0);
+	if(speed != shown_speed)
+	{
+		sevenseg_set_number(speed);
+		shown_speed = speed;
+	}
+	itoa(adc_result0, int_buffer, 10);
+}
+
+// answers the collector's requests; the clock has to be advanced at least every 400 ms
+void dispatch_task(void)
+{
+	ws_clock_task();
+	ws_dispatch_poll();
+}
+
+// only the characters that changed since the last flush go to the LCD
+void lcd_task(void)
+{
+	LCDFbWriteString(2,0,temperatures);
+	LCDFbWriteString(9,0,pressures);
+	LCDFbWriteString(2,1,altitudes);
+	LCDFbWriteString(10,1,int_buffer);
+	LCDFlush();
+}
+
 void main()
 {
+	// reset cause, cleared so the next reset reports only its own
+	uint8_t resetFlags = MCUSR;
+	MCUSR = 0;
 	
 	//Initialize LCD module
 	InitLCD();
-	//Clear the screen
-	LCDClear();
+	//Clear the screen and the framebuffer
+	LCDFbInit();
 	//Simple string printing
-	LCDWriteString("T:");
-	LCDWriteStringXY(0,1,"A:");	
-	LCDWriteStringXY(8,1,"L:");
-	LCDWriteStringXY(7,0,"P:");
+	LCDFbWriteString(0,0,"T:");
+	LCDFbWriteString(0,1,"A:");	
+	LCDFbWriteString(8,1,"L:");
+	LCDFbWriteString(7,0,"P:");
+	LCDFlush();
 	//Print some numbers
 	
-unsigned char num = 0x01;
-int i; 
-int speed_limit(); // calling the speed_limit function
-DDRB |= 0xFF;
 DDRA |= 0xFE; 
 
-	long temperature = 0;
-	long pressure = 0;
-	long alt = 0;
-	long weatherDiff =0;
-	long bmp085ReadTemp();
-	long bmp085ReadPressure();
-	long ut = 0;
-	long up = 0;
-
-	//long altitude = 0;
-	//double temp = 0;
-	
 	ioinit();
-	i2cInit();
-	delay_ms(100);
-	
-	BMP085_Calibration();
+	// requests from the collector are received in the USART RX ISR
+	ws_rx_init();
+	ws_minmax_init();
+	twi_init();
 
-	uint16_t adc_result0; 
-    char int_buffer[10];
-    char altitudes[10];
-	char pressures[10];
-	char temperatures[10];
+	// seven segment digits are multiplexed from the Timer2 ISR
+	sevenseg_init();
+	timebase_init();
+	// TWI transactions run from the TWI ISR, also during calibration
+	sei();
 
-    // initialize adc and lcd
+	// waits for the sensor only if the calibration has to come from the bus
+	BMP085_Calibration(resetFlags);
+
+    // light sensor is sampled from the ADC ISR on the timebase tick
     adc_init();
 
-while (1) {
-  D0=0;
-  D1=0;
-  bmp085Convert(&temperature, &pressure, &alt, &weatherDiff);
-   ltoa(weatherDiff, altitudes, 10);
-   ltoa(pressure, pressures, 10);
-   itoa(temperature, temperatures, 10);
- for (i=0; i<50; i++) {
-  D0=0;
-  D1=0;
-  num = speed_limit();
-adc_result0 = adc_read(0);      // read adc value at PA0
- itoa(adc_result0, int_buffer, 10);
-LCDWriteStringXY(2,0,temperatures);
-LCDWriteStringXY(9,0,pressures);
-LCDWriteStringXY(2,1,altitudes);
- LCDWriteStringXY(10,1,int_buffer);
-  PORTB = SEVEN_SEG[num%10];
-  D0=1;
-  D1=0;
-  _delay_us(500);
-  D0=0;
-  D1=0;
-  PORTB = SEVEN_SEG[num/10];
-  D0=0;
-  D1=1;
-  _delay_us(500);
-  } 
- }
+	// SHT1x on its own bit-banged bus, more than the 11 ms start-up time has passed
+	i2c_init();
+	sht1x_init();
+	sht1x_set_resolution(SHT1X_RESOLUTION);
+	sht1x_set_notify(sht1x_ready);
+	busplan_init();
+
+	// offsets keep the tasks from being released on the same tick
+	sensor_task_id = sched_add(sensor_task, SENSOR_PERIOD, 0);
+	sched_add(light_task, LIGHT_PERIOD, 1);
+	sched_add(lcd_task, LCD_PERIOD, 2);
+	sched_add(dispatch_task, DISPATCH_PERIOD, 3);
+	sched_run();
 }
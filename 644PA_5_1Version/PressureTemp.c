@@ -7,35 +7,78 @@
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <avr/eeprom.h>
+#include <stddef.h>
+#include <string.h>
 #include "types.h"
 #include "defs.h"
 //#include "math.h"	// To calculate altitude
 #include "i2c.h"
+#include "twi.h"
+#include "timebase.h"
+#include "uart.h"
+#include "PressureTemp.h"
+#include "ws_crc.h"
+#include "baro.h"
 
 #define FOSC 8000000
 #define BAUD 9600 //was 9600
 #define BMP085_R 0xEF
 #define BMP085_W 0xEE
-#define OSS 0	// Oversampling Setting (note: code is not set up to use other OSS values)
+#define BMP085_ADDR (BMP085_W >> 1)	// 7 bit address for the TWI driver
+#ifndef BMP085_OSS
+#define BMP085_OSS 0	// default oversampling setting (0..3), see bmp085SetOss()
+#endif
+#define BMP085_TEMP_US 4500	// max temperature conversion time
+
+#define STATION_ALTITUDE_M 1224.4	// altitude of the station, for weatherDiff
+#define STATION_ALTITUDE_Y BARO_STANDARD_Y(STATION_ALTITUDE_M)	// h / 44330 m in Q19
+
+// Optional EOC (end of conversion) input. Define these to the pin the
+// BMP085 EOC line is wired to and bmp085Poll() will use it instead of the
+// conversion timer.
+//#define BMP085_EOC_PINS PIND
+//#define BMP085_EOC_PIN  PD2
+
+// Measurement cycle states for bmp085Poll()
+#define BMP085_IDLE       0
+#define BMP085_TEMP_CMD   1	// temperature command on the bus
+#define BMP085_TEMP_CONV  2	// temperature conversion running
+#define BMP085_TEMP_READ  3	// temperature result read on the bus
+#define BMP085_PRESS_CMD  4	// pressure command on the bus
+#define BMP085_PRESS_CONV 5	// pressure conversion running
+#define BMP085_PRESS_READ 6	// pressure result read on the bus
 
 #define sbi(var, mask)   ((var) |= (uint8_t)(1 << mask))
 #define cbi(var, mask)   ((var) &= (uint8_t)~(1 << mask))
 
+// EEPROM copy of the calibration registers
+typedef struct
+{
+	uint8_t cal[22];	// registers 0xAA..0xBF as read (MSB first)
+	uint16_t crc;		// CRC-CCITT of the bytes above
+} bmp085Cache_t;
+
 ///============Function Prototypes=========/////////////////
-void BMP085_Calibration(void);
+void BMP085_Calibration(uint8_t resetFlags);
+static uint16_t bmp085CacheCrc(const bmp085Cache_t *cache);
+static char bmp085CalibrationValid(const uint8_t *cal);
+static uint8_t bmp085CalibrationTag(const uint8_t *cal);
 
 ///============I2C Prototypes=============//////////////////
 short bmp085ReadShort(unsigned char address);
+int8_t bmp085ReadBurst(unsigned char address, uint8_t *data, uint8_t len);
 long bmp085ReadTemp(void);
 long bmp085ReadPressure(void);
-void bmp085Convert(long * temperature, long * pressure, long * alt, long * weatherDiff);
+void bmp085StartTemp(void);
+void bmp085StartPressure(void);
+void bmp085StartRead(uint8_t len);
+long bmp085ReadResult(void);
+long bmp085ReadPressureResult(void);
+static void bmp085Calc(long ut, long up, uint8_t oss, long * temperature, long * pressure, long * alt, long * weatherDiff);
 
 ///============Initialize Prototypes=====//////////////////
 void ioinit(void);
-void UART_Init(unsigned int ubrr);
-static int uart_putchar(char c, FILE *stream);
-void put_char(unsigned char byte);
-static FILE mystdout = FDEV_SETUP_STREAM(uart_putchar, NULL, _FDEV_SETUP_WRITE);
 void delay_ms(uint16_t x);
 
 /////=========Global Variables======////////////////////
@@ -50,22 +93,117 @@ short b2;
 short mb;
 short mc;
 short md;
+uint8_t bmp085CalTag;	// CRC of the calibration in use, folded to 8 bits
+char bmp085Ready = FALSE;	// calibration loaded, the sensor can be used
+
+bmp085Cache_t EEMEM bmp085CacheEE;
+
+uint8_t bmp085State = BMP085_IDLE;
+uint16_t bmp085Started;	// timebase_fine() when the running conversion was started
+uint16_t bmp085Wait;	// conversion time of the running conversion (fine time)
+long bmp085Ut;	// raw temperature of the last cycle
+long bmp085Up;	// raw pressure of the last cycle
+uint8_t bmp085Oss = BMP085_OSS;	// oversampling setting for new cycles
+uint8_t bmp085CycleOss;	// oversampling setting of the running cycle
+uint16_t bmp085Errors;	// cycles dropped because the sensor did not answer
+
+// Bus transaction used by the measurement cycle
+static twi_xfer_t bmp085Xfer;
+static uint8_t bmp085Cmd[2];
+static uint8_t bmp085Result[3];
+
+// Max pressure conversion time per oversampling setting (datasheet)
+static const uint16_t bmp085PressUs[4] = {4500, 7500, 13500, 25500};
+
+// Read the 11 calibration words. resetFlags is MCUSR as it was at start-up.
+// After a warm reset (brown-out, watchdog or reset pin) the sensor kept its
+// power, so the EEPROM copy is used without touching the bus. After
+// power-on the calibration registers are read (one 22 byte burst) and the
+// copy is rewritten if they differ, e.g. when the sensor was swapped. If
+// the bus fails the copy is used if it is valid, otherwise the sensor is
+// left unusable: bmp085Start() refuses to run cycles.
+void BMP085_Calibration(uint8_t resetFlags)
+{
+	uint8_t cal[22];
+	bmp085Cache_t cache;
+	char cacheValid;
+	
+	bmp085Ready = FALSE;
+	
+	eeprom_read_block(&cache, &bmp085CacheEE, sizeof(cache));
+	cacheValid = bmp085CacheCrc(&cache) == cache.crc && bmp085CalibrationValid(cache.cal);
+	
+	if(!cacheValid || (resetFlags & (1<<PORF)) || !(resetFlags & ((1<<BORF)|(1<<WDRF)|(1<<EXTRF))))
+	{
+		delay_ms(100);	// sensor start-up time
+		
+		if(bmp085ReadBurst(0xAA, cal, sizeof(cal)) == TWI_OK && bmp085CalibrationValid(cal))
+		{
+			if(!cacheValid || memcmp(cache.cal, cal, sizeof(cal)) != 0)
+			{
+				memcpy(cache.cal, cal, sizeof(cal));
+				cache.crc = bmp085CacheCrc(&cache);
+				eeprom_update_block(&cache, &bmp085CacheEE, sizeof(cache));
+			}
+			cacheValid = TRUE;
+		}
+	}
+	
+	if(!cacheValid)
+		return;	// no calibration, md = 0 would divide by zero in bmp085Calc()
+	
+	ac1 = (cache.cal[0] << 8) | cache.cal[1];
+	ac2 = (cache.cal[2] << 8) | cache.cal[3];
+	ac3 = (cache.cal[4] << 8) | cache.cal[5];
+	ac4 = (cache.cal[6] << 8) | cache.cal[7];
+	ac5 = (cache.cal[8] << 8) | cache.cal[9];
+	ac6 = (cache.cal[10] << 8) | cache.cal[11];
+	b1 = (cache.cal[12] << 8) | cache.cal[13];
+	b2 = (cache.cal[14] << 8) | cache.cal[15];
+	mb = (cache.cal[16] << 8) | cache.cal[17];
+	mc = (cache.cal[18] << 8) | cache.cal[19];
+	md = (cache.cal[20] << 8) | cache.cal[21];
+	bmp085CalTag = bmp085CalibrationTag(cache.cal);
+	bmp085Ready = TRUE;
+}
 
-void BMP085_Calibration(void)
+// CRC over the calibration bytes of a cache entry
+static uint16_t bmp085CacheCrc(const bmp085Cache_t *cache)
 {
+	return ws_crc_block(WS_CRC_INIT, cache, offsetof(bmp085Cache_t, crc));
+}
+
+// None of the calibration words is 0x0000 or 0xFFFF (datasheet), so
+// either value means the read went wrong
+static char bmp085CalibrationValid(const uint8_t *cal)
+{
+	uint8_t i;
+	uint16_t word;
+	
+	for(i = 0; i < 22; i += 2)
+	{
+		word = (cal[i] << 8) | cal[i + 1];
+		if(word == 0x0000 || word == 0xFFFF)
+			return FALSE;
+	}
+	return TRUE;
+}
 
-	ac1 = bmp085ReadShort(0xAA);
-	ac2 = bmp085ReadShort(0xAC);
-	ac3 = bmp085ReadShort(0xAE);
-	ac4 = bmp085ReadShort(0xB0);
-	ac5 = bmp085ReadShort(0xB2);
-	ac6 = bmp085ReadShort(0xB4);
-	b1 = bmp085ReadShort(0xB6);
-	b2 = bmp085ReadShort(0xB8);
-	mb = bmp085ReadShort(0xBA);
-	mc = bmp085ReadShort(0xBC);
-	md = bmp085ReadShort(0xBE);
+// cal_tag of a calibration: its CRC with both bytes folded in. Two
+// sensors have the same tag about 1 time in 256.
+static uint8_t bmp085CalibrationTag(const uint8_t *cal)
+{
+	uint16_t crc = ws_crc_block(WS_CRC_INIT, cal, 22);
+	
+	return (crc >> 8) ^ crc;
+}
+
+// Read len sequential registers starting at address in one transaction
+int8_t bmp085ReadBurst(unsigned char address, uint8_t *data, uint8_t len)
+{
+	twi_xfer_t xfer = {BMP085_ADDR, TWI_FLAG_REPEATED_START, &address, 1, data, len, 0, NULL};
 	
+	return twi_transfer(&xfer);
 }
 
 // bmp085ReadShort will read two sequential 8-bit registers, and return a 16-bit value
@@ -74,111 +212,260 @@ void BMP085_Calibration(void)
 // Output: 16-bit value of (first register value << 8) | (sequential register value)
 short bmp085ReadShort(unsigned char address)
 {
-	uint16_t msb, lsb;
-	short data;
-	
-	i2cSendStart();
-	i2cWaitForComplete();
+	uint8_t data[2] = {0, 0};
+	twi_xfer_t xfer = {BMP085_ADDR, TWI_FLAG_REPEATED_START, &address, 1, data, 2, 0, NULL};
 	
-	i2cSendByte(BMP085_W);	// write 0xEE
-	i2cWaitForComplete();
+	twi_transfer(&xfer);
 	
-	i2cSendByte(address);	// write register address
-	i2cWaitForComplete();
-	
-	i2cSendStart();
-	
-	i2cSendByte(BMP085_R);	// write 0xEF
-	i2cWaitForComplete();
-	
-	i2cReceiveByte(TRUE);
-	i2cWaitForComplete();
-	msb = i2cGetReceivedByte();	// Get MSB result
-	i2cWaitForComplete();
-	
-	i2cReceiveByte(FALSE);
-	i2cWaitForComplete();
-	lsb = i2cGetReceivedByte();	// Get LSB result
-	i2cWaitForComplete();
-	
-	//i2cSendStop();
-	
-	data = msb << 8;
-	data |= lsb;
+	return ((short)data[0] << 8) | data[1];
+}
+
+// Queue bmp085Xfer. If the queue is full the transaction fails right
+// away, so bmp085Poll() drops the cycle instead of reading old results.
+static void bmp085Submit(void)
+{
+	int8_t ret = twi_submit(&bmp085Xfer);
 	
-	return data;
+	if(ret != TWI_PENDING)
+		bmp085Xfer.status = ret;
+}
+
+// Queue a control register write, conversion starts when it completes
+static void bmp085Command(unsigned char cmd)
+{
+	bmp085Cmd[0] = 0xF4;	// control register
+	bmp085Cmd[1] = cmd;
+	bmp085Xfer.addr = BMP085_ADDR;
+	bmp085Xfer.flags = 0;
+	bmp085Xfer.wbuf = bmp085Cmd;
+	bmp085Xfer.wlen = 2;
+	bmp085Xfer.rbuf = NULL;
+	bmp085Xfer.rlen = 0;
+	bmp085Xfer.done = NULL;
+	bmp085Submit();
+}
+
+void bmp085StartTemp(void)
+{
+	bmp085Command(0x2E);	// write register data for temp
+}
+
+void bmp085StartPressure(void)
+{
+	bmp085Command(0x34 | (bmp085CycleOss << 6));	// write register data for pressure
+}
+
+// Select the oversampling setting (0..3) used from the next cycle on.
+// Higher settings take longer (4.5, 7.5, 13.5, 25.5 ms) but have less noise.
+void bmp085SetOss(uint8_t oss)
+{
+	if(oss <= 3)
+		bmp085Oss = oss;
+}
+
+// Queue a read of the result registers of a finished conversion,
+// 2 bytes (MSB, LSB) for temperature or 3 (MSB, LSB, XLSB) for pressure
+void bmp085StartRead(uint8_t len)
+{
+	bmp085Cmd[0] = 0xF6;	// result MSB
+	bmp085Xfer.addr = BMP085_ADDR;
+	bmp085Xfer.flags = TWI_FLAG_REPEATED_START;
+	bmp085Xfer.wbuf = bmp085Cmd;
+	bmp085Xfer.wlen = 1;
+	bmp085Xfer.rbuf = bmp085Result;
+	bmp085Xfer.rlen = len;
+	bmp085Xfer.done = NULL;
+	bmp085Submit();
+}
+
+long bmp085ReadResult(void)
+{
+	return ((long)bmp085Result[0] << 8) | bmp085Result[1];
+}
+
+// 16 to 19 bit pressure value, depending on the oversampling setting
+long bmp085ReadPressureResult(void)
+{
+	return (((long)bmp085Result[0] << 16) | ((long)bmp085Result[1] << 8) | bmp085Result[2]) >> (8 - bmp085CycleOss);
 }
 
 long bmp085ReadTemp(void)
 {
-	long temperature = 0;
-	i2cSendStart();
-	i2cWaitForComplete();
-	
-	i2cSendByte(BMP085_W);	// write 0xEE
-	i2cWaitForComplete();
-	
-	i2cSendByte(0xF4);	// write register address for Temp
-	i2cWaitForComplete();
-	
-	i2cSendByte(0x2E);	// write register data for temp
-	i2cWaitForComplete();
+	bmp085StartTemp();
+	while(bmp085Xfer.status == TWI_PENDING);
 	
-	//i2cSendStop();
+	timebase_delay_us(BMP085_TEMP_US);
 	
-	delay_ms(10);	// max time is 4.5ms
+	bmp085StartRead(2);
+	while(bmp085Xfer.status == TWI_PENDING);
 	
-	temperature = bmp085ReadShort(0xF6);
-	temperature &= 0x0000FFFF;
-	
-	return temperature;
+	return bmp085ReadResult();
 }
 
 long bmp085ReadPressure(void)
 {
-	long pressure = 0;
-	
-	i2cSendStart();
-	i2cWaitForComplete();
-	
-	i2cSendByte(BMP085_W);	// write 0xEE
-	i2cWaitForComplete();
+	bmp085StartPressure();
+	while(bmp085Xfer.status == TWI_PENDING);
 	
-	i2cSendByte(0xF4);	// write register address for pressure
-	i2cWaitForComplete();
+	timebase_delay_us(bmp085PressUs[bmp085CycleOss]);
 	
-	i2cSendByte(0x34);	// write register data for pressure
-	i2cWaitForComplete();
+	bmp085StartRead(3);
+	while(bmp085Xfer.status == TWI_PENDING);
 	
-	i2cSendStop();
-	
-	delay_ms(10);	// max time is 4.5ms
-	
-	pressure = bmp085ReadShort(0xF6);
-	pressure &= 0x0000FFFF;
+	return bmp085ReadPressureResult();
+}
+
+// Mark the start of a conversion that takes at most us microseconds
+static void bmp085ConversionStarted(uint16_t us)
+{
+	bmp085Started = timebase_fine();
+	bmp085Wait = timebase_us_to_fine(us) + 1;	// +1 for the phase of the first count
+}
+
+// TRUE when the conversion started at bmp085Started has finished
+static char bmp085ConversionDone(void)
+{
+#ifdef BMP085_EOC_PIN
+	return (BMP085_EOC_PINS & (1<<BMP085_EOC_PIN)) != 0;
+#else
+	return (uint16_t)(timebase_fine() - bmp085Started) >= bmp085Wait;
+#endif
+}
+
+// Start a temperature + pressure measurement cycle. Returns immediately,
+// bmp085Poll() must then be called until it returns TRUE.
+void bmp085Start(void)
+{
+	if(bmp085State != BMP085_IDLE)
+		return;	// previous cycle still running
+	if(!bmp085Ready)
+	{
+		bmp085Errors++;	// no calibration, see BMP085_Calibration()
+		return;
+	}
+	
+	bmp085CycleOss = bmp085Oss;
+	bmp085StartTemp();
+	bmp085State = BMP085_TEMP_CMD;
+}
+
+// Advance the measurement cycle. Never waits for the bus or a conversion,
+// returns TRUE (and fills in the results) once the cycle has completed.
+char bmp085Poll(long* temperature, long* pressure, long* alt, long* weatherDiff)
+{
+	if(bmp085State == BMP085_IDLE || bmp085Xfer.status == TWI_PENDING)
+		return FALSE;
+	
+	if(bmp085Xfer.status != TWI_OK)
+	{
+		// sensor did not answer, drop this cycle
+		bmp085Errors++;
+		bmp085State = BMP085_IDLE;
+		return FALSE;
+	}
+	
+	switch(bmp085State)
+	{
+		case BMP085_TEMP_CMD:
+			// conversion time counts from the end of the command
+			bmp085ConversionStarted(BMP085_TEMP_US);
+			bmp085State = BMP085_TEMP_CONV;
+			break;
+		case BMP085_TEMP_CONV:
+			if(bmp085ConversionDone())
+			{
+				bmp085StartRead(2);
+				bmp085State = BMP085_TEMP_READ;
+			}
+			break;
+		case BMP085_TEMP_READ:
+			bmp085Ut = bmp085ReadResult();
+			bmp085StartPressure();
+			bmp085State = BMP085_PRESS_CMD;
+			break;
+		case BMP085_PRESS_CMD:
+			bmp085ConversionStarted(bmp085PressUs[bmp085CycleOss]);
+			bmp085State = BMP085_PRESS_CONV;
+			break;
+		case BMP085_PRESS_CONV:
+			if(bmp085ConversionDone())
+			{
+				bmp085StartRead(3);
+				bmp085State = BMP085_PRESS_READ;
+			}
+			break;
+		case BMP085_PRESS_READ:
+			bmp085State = BMP085_IDLE;
+			bmp085Up = bmp085ReadPressureResult();
+			bmp085Calc(bmp085Ut, bmp085Up, bmp085CycleOss, temperature, pressure, alt, weatherDiff);
+			return TRUE;
+	}
+	
+	return FALSE;
+}
+
+// TRUE while a measurement cycle runs. A cycle the sensor did not answer
+// ends without bmp085Poll() returning TRUE.
+char bmp085Busy(void)
+{
+	return bmp085State != BMP085_IDLE;
+}
+
+// Blocking measurement, waits out both conversions
+void bmp085Convert(long* temperature, long* pressure, long* alt, long* weatherDiff)
+{
+	if(!bmp085Ready)
+		return;
 	
-	return pressure;
+	bmp085CycleOss = bmp085Oss;
+	bmp085Ut = bmp085ReadTemp();
+	bmp085Up = bmp085ReadPressure();
 	
-	//return (long) bmp085ReadShort(0xF6);
+	bmp085Calc(bmp085Ut, bmp085Up, bmp085CycleOss, temperature, pressure, alt, weatherDiff);
 }
 
-void bmp085Convert(long* temperature, long* pressure, long* alt, long* weatherDiff)
+// Calibration in the protocol.h format, sent once, see bmp085FillRaw()
+void bmp085FillCal(ws_sensor_bmp085_cal_t* cal, uint16_t sensorId)
+{
+	cal->header.sensor_id = sensorId;
+	cal->header.pad1 = 0;
+	cal->header.pad2 = 0;
+	cal->ac1 = ac1;
+	cal->ac2 = ac2;
+	cal->ac3 = ac3;
+	cal->ac4 = ac4;
+	cal->ac5 = ac5;
+	cal->ac6 = ac6;
+	cal->b1 = b1;
+	cal->b2 = b2;
+	cal->mb = mb;
+	cal->mc = mc;
+	cal->md = md;
+	cal->cal_tag = bmp085CalTag;
+	cal->pad1 = 0;
+}
+
+// Raw values of the last cycle. The receiver compensates them with the
+// calibration it got with the same cal_tag.
+void bmp085FillRaw(ws_sensor_bmp085_raw_t* raw, uint16_t sensorId)
+{
+	raw->header.sensor_id = sensorId;
+	raw->header.pad1 = 0;
+	raw->header.pad2 = 0;
+	raw->temperature = bmp085Ut;
+	raw->oversampling = bmp085CycleOss;
+	raw->cal_tag = bmp085CalTag;
+	raw->pressure = bmp085Up;
+}
+
+static void bmp085Calc(long ut, long up, uint8_t oss, long* temperature, long* pressure, long* alt, long* weatherDiff)
 {
-	long ut;
-	long up;
 	long taltitude;
 	long tpressure;
 	long epressure;
-	const float currentAltitude = 1224.4;
-	const float p0=101325;
 	long x1, x2, b5, b6, x3, b3, p;
 	unsigned long b4, b7;
 	
-	ut = bmp085ReadTemp();
-	ut = bmp085ReadTemp();
-	up = bmp085ReadPressure();
-	up = bmp085ReadPressure();
-	
 	x1 = ((long)ut - ac6) * ac5 >> 15;
 	x2 = ((long) mc << 11) / (x1 + md);
 	b5 = x1 + x2;
@@ -188,20 +475,20 @@ void bmp085Convert(long* temperature, long* pressure, long* alt, long* weatherDi
 	x1 = (b2 * (b6 * b6 >> 12)) >> 11;
 	x2 = ac2 * b6 >> 11;
 	x3 = x1 + x2;
-	b3 = (((int32_t) ac1 * 4 + x3) + 2)/4;
+	b3 = ((((int32_t) ac1 * 4 + x3) << oss) + 2)/4;
 	x1 = ac3 * b6 >> 13;
 	x2 = (b1 * (b6 * b6 >> 12)) >> 16;
 	x3 = ((x1 + x2) + 2) >> 2;
 	b4 = (ac4 * (unsigned long) (x3 + 32768)) >> 15;
-	b7 = ((unsigned long) up - b3) * (50000 >> OSS);
+	b7 = ((unsigned long) up - b3) * (50000 >> oss);
 	p = b7 < 0x80000000 ? (b7 * 2) / b4 : (b7 / b4) * 2;
 	x1 = (p >> 8) * (p >> 8);
 	x1 = (x1 * 3038) >> 16;
 	x2 = (-7357 * p) >> 16;
 	tpressure = 90000;//p + 12000 +((x1 + x2 + 3791) >> 4); 
 	*alt = 1224.4;//((float)44330 * (1 - pow(((float) tpressure/p0), 0.190295)))*3.2808399;
-	*pressure = tpressure*pow(1- (((*alt/3.2808399)*0.0065)/(((*temperature/10))+(0.0065*(*alt/3.2808399)+273.15))), -5.257);
-	epressure = p0* pow((1-currentAltitude/44330), 5.257);
+	*pressure = baroSeaLevel(tpressure, *alt, *temperature);
+	epressure = baroStandard(STATION_ALTITUDE_Y);
 	*weatherDiff= tpressure - epressure;
 		
 }
@@ -219,39 +506,6 @@ void ioinit (void)
     DDRD |= 0b11111110; 
 	PORTC |= 0b00000011; //pullups on the I2C bus
 	
-	UART_Init((unsigned int)(FOSC/16/BAUD-1));		// ocillator fq/16/baud rate -1	
-}
-
-void UART_Init( unsigned int ubrr)
-{
-	// Set baud rate 
-	UBRR0H = ubrr>>8;
-	UBRR0L = ubrr;
-	
-	// Enable receiver and transmitter 
-	UCSR0A = (0<<U2X0);
-	UCSR0B = (1<<RXEN0)|(1<<TXEN0);
-	
-	// Set frame format: 8 bit, no parity, 1 stop bit,   
-	UCSR0C = (1<<UCSZ00)|(1<<UCSZ01);
-	
-	stdout = &mystdout; //Required for printf init
-}
-
-static int uart_putchar(char c, FILE *stream)
-{
-    if (c == '\n') uart_putchar('\r', stream);
-  
-    loop_until_bit_is_set(UCSR0A, UDRE0);
-    UDR0 = c;
-    
-    return 0;
-}
-
-void put_char(unsigned char byte)
-{
-	/* Wait for empty transmit buffer */
-	while ( !( UCSR0A & (1<<UDRE0)) );
-	/* Put data into buffer, sends the data */
-	UDR0 = byte;
+	// stdout and put_char() go through the interrupt driven TX buffer
+	uart_init(UART_UBRR(FOSC, BAUD));		// ocillator fq/16/baud rate -1	
 }
\ No newline at end of file
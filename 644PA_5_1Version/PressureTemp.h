@@ -0,0 +1,30 @@
+/*
+
+*/
+
+#ifndef PRESSURETEMP_H
+#define PRESSURETEMP_H
+
+#include <stdint.h>
+#include "protocol.h"
+
+// Initialization
+void ioinit(void);
+void BMP085_Calibration(uint8_t resetFlags);
+
+// Oversampling setting (0..3) for the next measurement cycle
+void bmp085SetOss(uint8_t oss);
+
+// Blocking measurement
+void bmp085Convert(long * temperature, long * pressure, long * alt, long * weatherDiff);
+
+// Non-blocking measurement: start a cycle, then poll until it returns TRUE
+void bmp085Start(void);
+char bmp085Poll(long * temperature, long * pressure, long * alt, long * weatherDiff);
+char bmp085Busy(void);
+
+// Calibration and last cycle as sensor notification subpackets
+void bmp085FillCal(ws_sensor_bmp085_cal_t * cal, uint16_t sensorId);
+void bmp085FillRaw(ws_sensor_bmp085_raw_t * raw, uint16_t sensorId);
+
+#endif
@@ -1,38 +1,131 @@
 #include <avr/io.h>
-#include <util/delay.h>
+#include <avr/interrupt.h>
+#include <util/atomic.h>
 
-#include "lcd.h"
+#include "TEMT6000.h"
 
 #define LTHRES 500
 #define RTHRES 500
 
+#define ADC_RING_MASK (ADC_RING_LEN - 1)
+#if (ADC_RING_LEN & ADC_RING_MASK) != 0 || ADC_RING_LEN > 64
+#error "ADC_RING_LEN must be a power of two not larger than 64"
+#endif
+
+static const uint8_t adc_channels[] = { ADC_CHANNEL_LIST };
+#define ADC_NUM_CHANNELS (sizeof(adc_channels) / sizeof(adc_channels[0]))
+
+// Written by the ADC ISR, one slot per entry of adc_channels
+static volatile uint16_t adc_latest[ADC_NUM_CHANNELS];
+static volatile uint16_t adc_sum[ADC_NUM_CHANNELS];	// sum of the ring, 64 * 1023 fits
+static volatile uint8_t adc_samples[ADC_NUM_CHANNELS];
+static uint16_t adc_ring[ADC_NUM_CHANNELS][ADC_RING_LEN];
+static uint8_t adc_pos[ADC_NUM_CHANNELS];
+static uint8_t adc_slot;	// slot of the conversion in progress
+
 // initialize adc
 void adc_init()
 {
-    // AREF = AVcc
-    ADMUX = (1<<REFS0);
-    // ADC Enable and prescaler of 128
-    // 16000000/128 = 125000
-    ADCSRA = (1<<ADEN)|(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0);
+    uint8_t i;
+
+    adc_slot = 0;
+    for(i = 0; i < ADC_NUM_CHANNELS; i++)
+    {
+        // digital input buffer is not needed on an analog pin
+        DIDR0 |= (1<<(adc_channels[i] & 0x07));
+    }
+
+    // AREF = AVcc, first channel
+    ADMUX = (1<<REFS0)|(adc_channels[0] & 0x07);
+    // conversions start on Timer0 compare match A, the 1 ms timebase tick
+    ADCSRB = (1<<ADTS1)|(1<<ADTS0);
+    // ADC Enable, auto trigger, interrupt and prescaler of 128
+    // 10000000/128 = 78125, one conversion takes 13 cycles = 166 us
+    ADCSRA = (1<<ADEN)|(1<<ADATE)|(1<<ADIE)|(1<<ADPS2)|(1<<ADPS1)|(1<<ADPS0);
+}
+
+// conversion done, store it and select the channel for the next trigger
+ISR(ADC_vect)
+{
+    uint8_t s = adc_slot;
+    uint8_t pos;
+    uint16_t val = ADC;
+
+    adc_latest[s] = val;
+    if(adc_samples[s] == 0)
+    {
+        // fill the ring with the first sample so the average is valid at once
+        for(pos = 0; pos < ADC_RING_LEN; pos++)
+            adc_ring[s][pos] = val;
+        adc_sum[s] = val * ADC_RING_LEN;
+    }
+    else
+    {
+        pos = adc_pos[s];
+        adc_sum[s] = adc_sum[s] - adc_ring[s][pos] + val;
+        adc_ring[s][pos] = val;
+        adc_pos[s] = (pos + 1) & ADC_RING_MASK;
+    }
+    // wraps 255 -> 1 so 0 keeps meaning "no sample yet"
+    if(++adc_samples[s] == 0)
+        adc_samples[s] = 1;
+
+    // the next conversion starts on the next tick, 1 ms from the last one
+    if(++s >= ADC_NUM_CHANNELS)
+        s = 0;
+    adc_slot = s;
+    ADMUX = (ADMUX & 0xE0)|(adc_channels[s] & 0x07);
 }
 
-// read adc value
+static int8_t adc_find(uint8_t ch)
+{
+    uint8_t i;
+
+    for(i = 0; i < ADC_NUM_CHANNELS; i++)
+    {
+        if(adc_channels[i] == ch)
+            return i;
+    }
+    return ADC_ERROR_CHANNEL;
+}
+
+// latest value of a channel, does not wait for a conversion
 int16_t adc_read(uint8_t ch)
 {
-    // select the corresponding channel 0~7
-    // ANDing with '7' will always keep the value
-    // of 'ch' between 0 and 7
-    ch &= 0b00000111;  // AND operation with 7
-    ADMUX = (ADMUX & 0xF8)|ch;     // clears the bottom 3 bits before ORing
-
-    // start single convertion
-    // write '1' to ADSC
-    ADCSRA |= (1<<ADSC);
-
-    // wait for conversion to complete
-    // ADSC becomes '0' again
-    // till then, run loop continuously
-    while(ADCSRA & (1<<ADSC));
-
-    return (ADC);
+    int8_t s = adc_find(ch);
+    int16_t val;
+
+    if(s < 0)
+        return ADC_ERROR_CHANNEL;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        val = adc_latest[s];
+    }
+    return val;
+}
+
+// mean of the last ADC_RING_LEN samples of a channel
+int16_t adc_average(uint8_t ch)
+{
+    int8_t s = adc_find(ch);
+    uint16_t sum;
+
+    if(s < 0)
+        return ADC_ERROR_CHANNEL;
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        sum = adc_sum[s];
+    }
+    return sum / ADC_RING_LEN;
+}
+
+// samples taken on a channel, changes when a new value is available
+// 0 until the first conversion is done
+uint8_t adc_count(uint8_t ch)
+{
+    int8_t s = adc_find(ch);
+
+    if(s < 0)
+        return 0;
+    return adc_samples[s];
 }
@@ -0,0 +1,32 @@
+/*
+
+*/
+
+#ifndef TEMT6000_H
+#define TEMT6000_H
+
+#include <stdint.h>
+
+// Channels sampled round-robin, one conversion per Timer0 compare match
+// (1 ms), so every channel is sampled at 1000 / ADC_NUM_CHANNELS Hz
+#ifndef ADC_CHANNEL_LIST
+#define ADC_CHANNEL_LIST 0
+#endif
+
+// Samples kept per channel for adc_average(), power of two
+#ifndef ADC_RING_LEN
+#define ADC_RING_LEN 16
+#endif
+
+// Returned by the cached reads for a channel that is not in ADC_CHANNEL_LIST
+#define ADC_ERROR_CHANNEL -1
+
+// Initialization, call after timebase_init()
+void adc_init(void);
+
+// Cached reads, these never start a conversion
+int16_t adc_read(uint8_t ch);
+int16_t adc_average(uint8_t ch);
+uint8_t adc_count(uint8_t ch);
+
+#endif
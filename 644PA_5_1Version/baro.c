@@ -0,0 +1,79 @@
+/*
+*
+* Barometric formula in integer math
+* Both reductions are (1 - y)^5.257 with a different y, taken from a table
+* for y = 0..1/8 with linear interpolation. host/ws_baro_bench checks it
+* against the double formula and fails over these bounds:
+*  - table points: 1 Q16 count from (1 - y)^5.257
+*  - baroSeaLevel(): 7 Pa for 0..13000 ft, -40..+60 C and 30..110 kPa
+*  - baroStandard(): 3 Pa for 0..5540 m
+* Above the table y is clamped to 1/8: from about 5100 m (16800 ft) at -40 C
+* for the sea level reduction, later when warmer, and from 5541 m for the
+* standard atmosphere (BARO_STANDARD_Y()).
+*
+*/
+
+#include <stdint.h>
+#include "baro.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+/* (1 - y)^5.257 for y = 0..1/8 in steps of 1/512, Q16 (1.0 clamped to 65535) */
+static const uint16_t baroTable[65] PROGMEM = {
+	65535, 64866, 64201, 63542, 62889, 62241, 61598, 60961,
+	60329, 59702, 59081, 58465, 57854, 57248, 56648, 56052,
+	55462, 54877, 54296, 53721, 53151, 52585, 52025, 51469,
+	50918, 50372, 49830, 49294, 48762, 48235, 47712, 47194,
+	46680, 46171, 45667, 45167, 44671, 44180, 43693, 43211,
+	42733, 42259, 41789, 41324, 40863, 40406, 39953, 39505,
+	39060, 38620, 38183, 37751, 37322, 36898, 36477, 36060,
+	35647, 35238, 34833, 34432, 34034, 33640, 33250, 32863,
+	32480,
+};
+
+/* (1 - y)^5.257 for y in Q19, result in Q16. A 16 bit y is always below 1/8, */
+/* the end of the table, so callers clamp larger y to 0xFFFF.                 */
+uint16_t baroFactor(uint16_t y) {
+	uint8_t i;
+	uint16_t a, b;
+
+	/* linear interpolation between table points 1024 (1/512 in Q19) apart */
+	i = y >> 10;
+	a = pgm_read_word(&baroTable[i]);
+	b = pgm_read_word(&baroTable[i + 1]);
+	return a - (uint16_t)(((uint32_t)(a - b) * (y & 0x3FF) + 512) >> 10);
+}
+
+/* Reduce station pressure p (Pa) to sea level for altitude altFt (feet) and */
+/* temperature t (0.1 C): p / (1 - L*h / (T + L*h))^5.257, L = 0.0065 K/m    */
+long baroSeaLevel(long p, long altFt, long t) {
+	uint32_t lh;	/* L*h in 1e-4 K */
+	uint32_t tk;	/* T + L*h in 1e-4 K */
+	uint32_t y;
+	uint16_t g;
+
+	if(altFt <= 0) {
+		return p;
+	}
+
+	lh = ((uint32_t)altFt * 19812 + 500) / 1000;	/* 0.0065 K/m * 0.3048 m/ft */
+	tk = (uint32_t)(t * 1000 + 2731500) + lh;
+	y = ((lh << 13) + (tk >> 7)) / (tk >> 6);	/* Q19 */
+	g = baroFactor(y > 0xFFFF ? 0xFFFF : y);	/* clamp to the end of the table */
+
+	/* p * 65536 / g without overflowing 32 bits */
+	return ((uint32_t)p / g << 16) + (((uint32_t)p % g << 16) + g / 2) / g;
+}
+
+/* Standard atmosphere pressure (Pa) at altitude y = h / 44330 m (Q19): */
+/* p0 * (1 - y)^5.257                                                   */
+long baroStandard(uint16_t y) {
+	uint16_t g = baroFactor(y);
+
+	return (((SEA_LEVEL_PA & 0xFFFF) * g + 0x8000) >> 16) + (SEA_LEVEL_PA >> 16) * g;
+}
@@ -0,0 +1,34 @@
+/*
+*
+* Barometric formula in integer math
+* Sea level reduction and standard atmosphere pressure without pow() and float.
+*
+* The file also builds on the host (host/Makefile), where ws_baro_bench
+* checks it against the double formula.
+*
+*/
+
+#ifndef _BARO_
+#define _BARO_
+
+#include <stdint.h>
+
+#define SEA_LEVEL_PA 101325UL	/* standard sea level pressure */
+
+/* h / 44330 m in Q19, the y of baroStandard(), for h in m. Clamped to the end of */
+/* the table (y = 1/8) from 5541 m; within 3 Pa of the formula up to 5540 m.     */
+#define BARO_STANDARD_Y(h) ((h) >= 5541 ? 0xFFFF : (uint16_t)((h) * 524288.0 / 44330 + 0.5))
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint16_t baroFactor(uint16_t y);
+long baroSeaLevel(long p, long altFt, long t);
+long baroStandard(uint16_t y);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -11,6 +11,7 @@
 #include <util/delay.h>
 #include "bmp085-driver.h"
 #include "i2c-driver.h"
+#include "timebase.h"
 
 /* I2C Address and read/write bit (lsb) of BMP085 */
 #define BMP085_ADDRESS_READ  0xEF
@@ -27,6 +28,9 @@
 #define BMP085_CREG_TEMP   0x2E /* Temperature                        */
 #define BMP085_CREG_PRESS  0x34 /* Pressure (over sampling setting 0) */
 
+/* Max pressure conversion time (us) for each over sampling setting */
+static const uint16_t bmp085_press_us[] = {4500, 7500, 13500, 25500};
+
 int8_t bmp085_read_calibration_data(uint8_t *cdata) {
 	uint8_t data[] = {BMP085_ADDRESS_WRITE, BMP085_REG_CAL_START};
 
@@ -78,30 +82,9 @@ int8_t bmp085_read_pressure(uint32_t *p_pr, bmp085_oss_t oss) {
 		return BMP085_ERROR_I2C;
 	}
 
-#if 0
-	/* Wait for conversion complete (depends on oss) */
-	switch(oss) {
-		case bmp085_oss_0:
-			_delay_ms(5);
-			break;
-		case bmp085_oss_1:
-			_delay_ms(8);
-			break;
-		case bmp085_oss_2:
-			_delay_ms(14);
-			break;
-		case bmp085_oss_3:
-		default:
-			_delay_ms(26);
-			break;
-	}
-#endif
-#if 0
-	/* This takes over 800 bytes of space! */
-	_delay_ms(2 + (3 << ((uint8_t)oss)));
-#endif
-	/* Save some flash and always wait enough */
-	_delay_ms(26);
+	/* Wait for conversion complete (depends on oss). A variable _delay_ms() */
+	/* takes over 800 bytes of space, the timer based delay only a few.      */
+	timebase_delay_us(bmp085_press_us[oss & 3]);
 
 
 	/* Set register to MSB */
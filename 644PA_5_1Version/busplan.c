@@ -0,0 +1,137 @@
+/*
+*
+* Sensor bus planner
+* Runs the SHT1X and BMP085 measurement cycles side by side: the conversions overlap and
+* nothing waits for one.
+*
+*/
+
+#include <stdint.h>
+#include "busplan.h"
+#include "PressureTemp.h"
+#include "sht1x-driver.h"
+#include "timebase.h"
+
+/* The BMP085 is on the TWI peripheral (twi.c), the SHT1X on the bit-banged lines of */
+/* i2c-driver.c. A cycle of one sensor never waits for the other: while the SHT1X     */
+/* converts (up to 320 ms) the BMP085 goes through its cycles (up to 30 ms each) and  */
+/* the SHT1X result is picked up when its pin change interrupt says it is ready.      */
+/* The SHT1X keeps the bit-banged bus (transmission started) from the command to the  */
+/* result, so i2c_set_mode() refuses other modes during a conversion; a start that    */
+/* finds the bus in use is tried again on the next poll.                              */
+
+typedef struct {
+	uint16_t period;
+	uint16_t next;     /* timebase_ms() of the next start */
+	uint8_t running;
+	uint16_t samples;  /* Cycles completed (wraps) */
+	uint16_t errors;   /* Cycles that failed (wraps) */
+} busplan_sensor_t;
+
+#define BUSPLAN_N 2
+
+static busplan_sensor_t busplan_sensors[BUSPLAN_N];
+
+static busplan_sensor_t *busplan_get(uint8_t sensor) {
+	return &busplan_sensors[sensor == BUSPLAN_SHT1X ? 1 : 0];
+}
+
+void busplan_init(void) {
+	uint16_t now = timebase_ms();
+	uint8_t i;
+
+	for(i = 0; i < BUSPLAN_N; i++) {
+		busplan_sensors[i].next = now;
+		busplan_sensors[i].running = 0;
+		busplan_sensors[i].samples = 0;
+		busplan_sensors[i].errors = 0;
+	}
+	busplan_get(BUSPLAN_BMP085)->period = BUSPLAN_BMP085_PERIOD;
+	busplan_get(BUSPLAN_SHT1X)->period = BUSPLAN_SHT1X_PERIOD;
+}
+
+/* Time between cycle starts, 0 = back to back */
+void busplan_set_period(uint8_t sensor, uint16_t period_ms) {
+	busplan_get(sensor)->period = period_ms;
+}
+
+/* Is a new cycle due? Keeps the start grid, unless a whole period was missed. */
+static uint8_t busplan_due(busplan_sensor_t *s, uint16_t now) {
+	if(s->running || !TIMEBASE_REACHED(now, s->next)) {
+		return 0;
+	}
+	s->next += s->period;
+	if(TIMEBASE_REACHED(now, s->next)) {
+		s->next = now + s->period;
+	}
+	return 1;
+}
+
+/* Start, advance and finish the cycles. Call every ms (the BMP085 conversion ends */
+/* are timed) and when the SHT1X notifies. Returns BUSPLAN_* bits of the sensors    */
+/* that completed a cycle: BMP085 results are in bmp085, SHT1X ones in sht1x_fill().  */
+uint8_t busplan_poll(busplan_bmp085_t *bmp085) {
+	busplan_sensor_t *sht = busplan_get(BUSPLAN_SHT1X);
+	busplan_sensor_t *bmp = busplan_get(BUSPLAN_BMP085);
+	uint16_t now = timebase_ms();
+	uint8_t done = 0;
+	long t, p, a, w;
+	int8_t rc;
+
+	/* SHT1X first: its conversion is the long one, the sooner it runs the better */
+	if(!sht->running && TIMEBASE_REACHED(now, sht->next)) {
+		rc = sht1x_start();
+		if(rc == SHT1X_OK) {
+			busplan_due(sht, now);
+			sht->running = 1;
+		} else if(rc != SHT1X_ERROR_BUSY && rc != SHT1X_ERROR_MODE_CHANGE) {
+			busplan_due(sht, now);
+			sht->errors++;
+		}
+	}
+	if(sht->running) {
+		rc = sht1x_poll();
+		if(rc == SHT1X_OK) {
+			sht->running = 0;
+			sht->samples++;
+			done |= BUSPLAN_SHT1X;
+		} else if(rc != SHT1X_PENDING) {
+			sht->running = 0;
+			sht->errors++;
+		}
+	}
+
+	/* The BMP085 cycles run in the SHT1X conversion time */
+	if(busplan_due(bmp, now)) {
+		bmp085Start();
+		bmp->running = 1;
+	}
+	if(bmp->running) {
+		if(bmp085Poll(&t, &p, &a, &w)) {
+			bmp085->temperature = t;
+			bmp085->pressure = p;
+			bmp085->alt = a;
+			bmp085->weather_diff = w;
+			bmp->running = 0;
+			bmp->samples++;
+			done |= BUSPLAN_BMP085;
+		} else if(!bmp085Busy()) {
+			/* Sensor did not answer, the cycle was dropped */
+			bmp->running = 0;
+			bmp->errors++;
+		}
+	}
+
+	return done;
+}
+
+/* Cycles completed since busplan_init() (wraps). Samples per second is the  */
+/* difference of two readings over the time between them.                   */
+uint16_t busplan_samples(uint8_t sensor) {
+	return busplan_get(sensor)->samples;
+}
+
+/* Cycles that failed since busplan_init() (wraps) */
+uint16_t busplan_errors(uint8_t sensor) {
+	return busplan_get(sensor)->errors;
+}
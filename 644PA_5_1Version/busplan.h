@@ -0,0 +1,43 @@
+/*
+*
+* Sensor bus planner
+* Runs the SHT1X and BMP085 measurement cycles side by side: the conversions overlap and
+* nothing waits for one.
+*
+*/
+
+#ifndef _BUSPLAN_
+#define _BUSPLAN_
+
+#include <stdint.h>
+
+/* Time in ms between the starts of two cycles. 0 starts the next cycle as soon as the  */
+/* previous one is done (BMP085 about 30 per second at oversampling 3, SHT1X about 2.5  */
+/* at 14/12 bits; mind the SHT1X self-heating and the UART bandwidth).                 */
+#ifndef BUSPLAN_BMP085_PERIOD
+#define BUSPLAN_BMP085_PERIOD 1000
+#endif
+#ifndef BUSPLAN_SHT1X_PERIOD
+#define BUSPLAN_SHT1X_PERIOD 5000
+#endif
+
+/* Sensors, bits returned by busplan_poll() */
+#define BUSPLAN_BMP085 0x01
+#define BUSPLAN_SHT1X  0x02
+
+/* Results of a BMP085 cycle */
+typedef struct {
+	long temperature;
+	long pressure;
+	long alt;
+	long weather_diff;
+} busplan_bmp085_t;
+
+/* Function prototypes */
+void busplan_init(void);
+void busplan_set_period(uint8_t sensor, uint16_t period_ms);
+uint8_t busplan_poll(busplan_bmp085_t *bmp085);
+uint16_t busplan_samples(uint8_t sensor);
+uint16_t busplan_errors(uint8_t sensor);
+
+#endif
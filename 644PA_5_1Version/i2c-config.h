@@ -9,14 +9,24 @@
 #ifndef _I2C_CONFIG_
 #define _I2C_CONFIG_
 
-/* Config for the sensor */
-#define I2C_SCL_PORT      (PORTB)
-#define I2C_SCL_PINS      (PINB)
-#define I2C_SCL_PIN       (PB6)
-#define I2C_SCL_CONTROL   (DDRB)
-#define I2C_DATA_PORT     (PORTB)
-#define I2C_DATA_PINS     (PINB)
-#define I2C_DATA_PIN      (PB7)
-#define I2C_DATA_CONTROL  (DDRB)
+/* Config for the sensor. SHT1X SCK on PC3 and DATA on PC2: PORTB drives the seven segment */
+/* display, PC0/PC1 are the TWI lines of the BMP085 and PC4..PC7 the LCD data lines.      */
+/* DATA is open drain and needs the external pull-up of the Sensirion reference circuit  */
+/* (10 kOhm to VDD). SCK needs none in SHT1X mode, the driver drives it both ways.       */
+#define I2C_SCL_PORT      (PORTC)
+#define I2C_SCL_PINS      (PINC)
+#define I2C_SCL_PIN       (PC3)
+#define I2C_SCL_CONTROL   (DDRC)
+#define I2C_DATA_PORT     (PORTC)
+#define I2C_DATA_PINS     (PINC)
+#define I2C_DATA_PIN      (PC2)
+#define I2C_DATA_CONTROL  (DDRC)
+
+/* Pin change interrupt of the data pin (PC2 = PCINT18) */
+#define I2C_DATA_PCMSK     (PCMSK2)
+#define I2C_DATA_PCINT     (PCINT18)
+#define I2C_DATA_PCIE      (PCIE2)
+#define I2C_DATA_PCIF      (PCIF2)
+#define I2C_DATA_PCINT_vect PCINT2_vect
 
 #endif
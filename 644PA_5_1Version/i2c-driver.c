@@ -7,6 +7,10 @@
 *
 */
 
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
 #include <avr/io.h>
 #include <util/delay.h>
 #include <stdlib.h>
@@ -21,16 +25,25 @@
 							   /* communication they can be separate.                                    */
 #define I2C_DELAY_DATA_HOLD  1 /* Delay that data line must be held after SCL has been set low.          */
 
+/* Longest time (in us) a slave may stretch the clock before the master carries on anyway */
+#ifndef I2C_CLOCK_STR_US
+#define I2C_CLOCK_STR_US 1000
+#endif
+
 /* Macros to help with pin control */
 #define I2C_DATA_LOW()     (I2C_DATA_CONTROL |= _BV(I2C_DATA_PIN))
 #define I2C_DATA_HIGH()    (I2C_DATA_CONTROL &= ~(_BV(I2C_DATA_PIN)))
 #define I2C_DATA_RELEASE() (I2C_DATA_HIGH()) /* Means the same thing as high because we use pull-up to get data line high */
-#define I2C_SCL_LOW()      (I2C_SCL_CONTROL |= _BV(I2C_SCL_PIN))
-#define I2C_SCL_HIGH()     (I2C_SCL_CONTROL &= ~(_BV(I2C_SCL_PIN)))
-#define I2C_SCL_RELEASE()  (I2C_SCL_HIGH())  /* Means the same thing as high because we use pull-up to get data line high */
+/* Normal I2C releases SCL to the pull-up. The SHT1X has no pull-up on SCK (Sensirion */
+/* reference circuit) and never stretches the clock, so in SHT1X mode SCL is driven.   */
+#define I2C_SCL_LOW()      (I2C_SCL_PORT &= ~(_BV(I2C_SCL_PIN)), I2C_SCL_CONTROL |= _BV(I2C_SCL_PIN))
+#define I2C_SCL_HIGH()     ((i2c_sb & _BV(I2C_SB_MODE_SHT1X)) ? \
+                            (void)(I2C_SCL_PORT |= _BV(I2C_SCL_PIN), I2C_SCL_CONTROL |= _BV(I2C_SCL_PIN)) : \
+                            (void)(I2C_SCL_CONTROL &= ~(_BV(I2C_SCL_PIN)), I2C_SCL_PORT &= ~(_BV(I2C_SCL_PIN))))
+#define I2C_SCL_RELEASE()  (I2C_SCL_HIGH())  /* Means the same thing as high: pull-up (normal) or driven (SHT1X) */
 
 /* Clock stretching: Wait until SCL is really high */
-#define I2C_WAIT_CLOCK_STR() {while(!(I2C_SCL_PINS & _BV(I2C_SCL_PIN)));}
+#define I2C_WAIT_CLOCK_STR() (i2c_wait_clock_str())
 
 /* Prototypes for local helper functions */
 void i2c_transmission_start(void);
@@ -41,6 +54,19 @@ volatile uint8_t i2c_sb;
 #define I2C_SB_STARTED    0 /* Transmission started */
 #define I2C_SB_MODE_SHT1X 1 /* SHT1X mode           */
 
+/* Wait at most I2C_CLOCK_STR_US for a slave to let go of SCL. Nothing */
+/* to wait for in SHT1X mode, SCL is driven high.                      */
+static void i2c_wait_clock_str(void) {
+	uint16_t us;
+
+	if(i2c_sb & _BV(I2C_SB_MODE_SHT1X)) {
+		return;
+	}
+	for(us = 0; us < I2C_CLOCK_STR_US && !(I2C_SCL_PINS & _BV(I2C_SCL_PIN)); us++) {
+		_delay_us(1);
+	}
+}
+
 /* Initialize SHT1x sensor */
 void i2c_init(void) {
 	/* Tri-state clock pin, set output low (when turned to output) and release it */
@@ -99,12 +125,13 @@ uint8_t i2c_read_bytes(uint8_t *buffer, uint16_t len, bool ack_last, bool stop)
 	uint8_t p = 0;
 
 	/* When reading from SHT1X the first bit is always 0. */
-	/* Also, we must wait till SHT1X pulls data line low  */
-	/* after asking for measurement and before reading    */
-	/* the result. (Not sure if this works for all cmds.) */
+	/* Also, SHT1X pulls data line low when a measurement */
+	/* is ready. Up to 320 ms is too long to wait here:   */
+	/* the caller waits for it (see i2c_data_low()).      */
 	if(i2c_sb & _BV(I2C_SB_MODE_SHT1X)) {
-		/* Wait until sensor pulls data line low */
-		while((I2C_DATA_PINS & _BV(I2C_DATA_PIN)));
+		if((I2C_DATA_PINS & _BV(I2C_DATA_PIN))) {
+			return I2C_ERROR_NOT_READY;
+		}
 	}
 
 	while(len > 0) {
@@ -207,8 +234,29 @@ uint8_t i2c_write_bytes(const uint8_t *buffer, uint16_t len, bool start, bool st
 	return retval;
 }
 
+/* Clock out 9 bits with the data line released. A slave that was left in the */
+/* middle of a byte lets go of the data line (SHT1X "connection reset").       */
+void i2c_bus_clear(void) {
+	uint8_t i;
+
+	I2C_DATA_RELEASE();
+	for(i = 0; i < 9; i++) {
+		I2C_SCL_RELEASE();
+		_delay_us(I2C_DELAY_SCL);
+		I2C_SCL_LOW();
+		_delay_us(I2C_DELAY_SCL);
+	}
+
+	i2c_sb &= ~(_BV(I2C_SB_STARTED));
+}
+
+/* True if the data line is low. A SHT1X pulls it low when a measurement is ready. */
+bool i2c_data_low(void) {
+	return !(I2C_DATA_PINS & _BV(I2C_DATA_PIN));
+}
+
 uint8_t i2c_set_mode(const uint8_t mode) {
-	if(i2c_sb & I2C_SB_STARTED) {
+	if(i2c_sb & _BV(I2C_SB_STARTED)) {
 		/* Can't switch mode when transmission is on */
 		return I2C_ERROR_BUSY;
 	}
@@ -223,6 +271,8 @@ uint8_t i2c_set_mode(const uint8_t mode) {
 		default:
 			return I2C_ERROR_UNKNOWN_MODE;
 	}
+	/* Idle SCL the way the mode drives it */
+	I2C_SCL_RELEASE();
 
 	return I2C_OK;
 }
@@ -11,12 +11,14 @@
 #define _I2C_DRIVER_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 /* Return values */
 #define I2C_OK                  0
 #define I2C_ERROR_NO_ACK       -1
 #define I2C_ERROR_BUSY         -2
 #define I2C_ERROR_UNKNOWN_MODE -3
+#define I2C_ERROR_NOT_READY    -4 /* SHT1X has not pulled the data line low yet */
 
 /* Modes */
 #define I2C_MODE_NORMAL 0 /* Normal I2C (Default) */
@@ -31,4 +33,6 @@ void i2c_transmission_stop(void);
 uint8_t i2c_read_bytes(uint8_t *buffer, uint16_t len, bool ack_last, bool stop);
 uint8_t i2c_write_bytes(const uint8_t *buffer, uint16_t len, bool start, bool stop);
 uint8_t i2c_set_mode(const uint8_t mode);
+void i2c_bus_clear(void);
+bool i2c_data_low(void);
 #endif
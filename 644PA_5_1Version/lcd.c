@@ -2,10 +2,11 @@
 #include <inttypes.h>
 
 #ifndef F_CPU
-#define F_CPU 16000000UL
+#define F_CPU 10000000UL
 #endif
 
 #include <util/delay.h>
+#include <avr/interrupt.h>
 
 #include "lcd.h"
 
@@ -31,15 +32,44 @@
 #define CLEAR_RS() (LCD_RS_PORT&=(~(1<<LCD_RS_POS)))
 #define CLEAR_RW() (LCD_RW_PORT&=(~(1<<LCD_RW_POS)))
 
+//Output queue timing. Timer1 runs at F_CPU/8 in CTC mode and the ISR
+//sends one byte per tick. A tick must be longer than the 37us execution
+//time of a normal command (about 53us with the slowest LCD oscillator).
+#define LCD_TICK_US 60
+#define LCD_TIMER_OCR (F_CPU/8*LCD_TICK_US/1000000UL-1)	//74 at 10 MHz
+#if LCD_TIMER_OCR > 0xFFFF
+#error "LCD_TICK_US too long for Timer1 with prescaler 8"
+#endif
 
-void LCDByte(uint8_t c,uint8_t isdata)
+//Clear and home take 1.52ms, wait 2ms before the next byte
+#define LCD_HOLDOFF_TICKS ((2000+LCD_TICK_US-1)/LCD_TICK_US)
+
+#define LCD_QUEUE_MASK (LCD_QUEUE_LEN-1)
+#if (LCD_QUEUE_LEN & LCD_QUEUE_MASK) != 0 || LCD_QUEUE_LEN > 256
+#error "LCD_QUEUE_LEN must be a power of two not larger than 256"
+#endif
+
+//Output queue. LCDByte() writes at the head, the Timer1 ISR reads at the tail.
+static uint8_t lcd_q_byte[LCD_QUEUE_LEN];
+static uint8_t lcd_q_rs[LCD_QUEUE_LEN];
+static volatile uint8_t lcd_q_head;
+static volatile uint8_t lcd_q_tail;
+static uint8_t lcd_holdoff;	//Ticks to wait before the next byte
+
+//Shadow framebuffer
+static char lcd_fb[LCD_ROWS][LCD_COLS];		//What should be on the display
+static char lcd_shadow[LCD_ROWS][LCD_COLS];	//What is on the display
+
+
+static void LCDSend(uint8_t c,uint8_t isdata)
 {
 //Sends a byte to the LCD in 4bit mode
-//cmd=0 for data
-//cmd=1 for command
+//isdata=0 for command
+//isdata=1 for data
 
 
-//NOTE: THIS FUNCTION RETURS ONLY WHEN LCD HAS PROCESSED THE COMMAND
+//NOTE: THE LCD IS NOT READY FOR THE NEXT BYTE WHEN THIS RETURNS,
+//THE CALLER HAS TO WAIT ONE LCD_TICK_US (LCD_HOLDOFF_TICKS FOR CLEAR/HOME)
 
 uint8_t hn,ln;			//Nibbles
 uint8_t temp;
@@ -82,14 +112,80 @@ _delay_us(1);			//tEH
 
 CLEAR_E();
 
-_delay_us(1);			//tEL
+//tEL is covered by the wait for the LCD to execute the byte
+}
+
+static void LCDService()
+{
+	//Sends the next queued byte, called once per tick
+	uint8_t c,isdata;
+
+	if(lcd_holdoff)
+	{
+		lcd_holdoff--;
+		return;
+	}
+
+	if(lcd_q_tail==lcd_q_head)
+	{
+		//Queue empty, stop the tick until LCDByte() queues more
+		TIMSK1&=~(1<<OCIE1A);
+		return;
+	}
 
-LCDBusyLoop();
+	c=lcd_q_byte[lcd_q_tail];
+	isdata=lcd_q_rs[lcd_q_tail];
+	lcd_q_tail=(lcd_q_tail+1)&LCD_QUEUE_MASK;
+
+	LCDSend(c,isdata);
+
+	//Clear display (0x01) and return home (0x02/0x03) are the slow ones
+	if(!isdata && c!=0 && (c & 0xFC)==0)
+		lcd_holdoff=LCD_HOLDOFF_TICKS;
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+	LCDService();
+}
+
+void LCDByte(uint8_t c,uint8_t isdata)
+{
+//Queues a byte for the LCD
+//isdata=0 for command
+//isdata=1 for data
+
+//Returns at once unless the queue is full. The byte is sent from the
+//Timer1 compare ISR.
+
+uint8_t next;
+
+next=(lcd_q_head+1)&LCD_QUEUE_MASK;
+
+while(next==lcd_q_tail)
+{
+	//Queue full. With interrupts off the ISR can not drain it, so
+	//do its work here.
+	if(!(SREG & (1<<SREG_I)))
+	{
+		_delay_us(LCD_TICK_US);
+		LCDService();
+	}
+}
+
+lcd_q_byte[lcd_q_head]=c;
+lcd_q_rs[lcd_q_head]=isdata;
+lcd_q_head=next;
+
+//Start the tick. If it was stopped, at least one tick has passed since
+//the last byte, so the pending compare match may fire right away.
+TIMSK1|=(1<<OCIE1A);
 }
 
 void LCDBusyLoop()
 {
 	//This function waits till lcd is BUSY
+	//Only for InitLCD(), it must not run while the output queue is busy
 
 	uint8_t busy,status=0x00,temp;
 
@@ -185,6 +281,15 @@ void InitLCD()
 
 	//Now the LCD is in 4-bit mode
 
+	//Timer1 drains the output queue, the interrupt is enabled by LCDByte()
+	lcd_q_head=0;
+	lcd_q_tail=0;
+	lcd_holdoff=0;
+	TCCR1A=0;
+	TCCR1B=(1<<WGM12)|(1<<CS11);	//CTC, F_CPU/8
+	OCR1A=LCD_TIMER_OCR;
+	TCNT1=0;
+
 	LCDCmd(0b00001100);	//Display On
 	LCDCmd(0b00101000);			//function set 4-bit,2 line 5x7 dot format
 }
@@ -249,7 +354,76 @@ void LCDGotoXY(uint8_t x,uint8_t y)
   }
 }
 
+void LCDFbInit()
+{
+	/*****************************************************************
+
+	This function clears the display and the shadow framebuffer.
+	Must be called before the other LCDFb functions.
+
+	*****************************************************************/
+	uint8_t x,y;
+
+	LCDClear();
+	for(y=0;y<LCD_ROWS;y++)
+	{
+		for(x=0;x<LCD_COLS;x++)
+		{
+			lcd_fb[y][x]=' ';
+			lcd_shadow[y][x]=' ';
+		}
+	}
+}
+
+void LCDFbWriteString(uint8_t x,uint8_t y,const char *msg)
+{
+	/*****************************************************************
+
+	This function writes a string into the framebuffer. Nothing is
+	sent to the LCD until LCDFlush() is called. Characters past the
+	end of the row are dropped.
+
+	Arguments:
+	x,y: position of the first character
+	msg: a null terminated string to print
+
+	*****************************************************************/
+	if(y>=LCD_ROWS) return;
+
+	while(*msg!='\0' && x<LCD_COLS)
+	{
+		lcd_fb[y][x]=*msg;
+		msg++;
+		x++;
+	}
+}
 
+void LCDFlush()
+{
+	/*****************************************************************
 
+	This function sends the cells that differ from what is on the
+	display. The LCD moves its cursor after every character, so a run
+	of changed cells needs only one LCDGotoXY().
 
+	*****************************************************************/
+	uint8_t x,y;
+	uint8_t cx=0xFF;	//Column of the LCD cursor, 0xFF if unknown
 
+	for(y=0;y<LCD_ROWS;y++)
+	{
+		for(x=0;x<LCD_COLS;x++)
+		{
+			if(lcd_fb[y][x]==lcd_shadow[y][x])
+				continue;
+
+			if(cx!=x)
+				LCDGotoXY(x,y);
+
+			LCDData(lcd_fb[y][x]);
+			lcd_shadow[y][x]=lcd_fb[y][x];
+			cx=x+1;
+		}
+		cx=0xFF;	//Next row starts at a different address
+	}
+}
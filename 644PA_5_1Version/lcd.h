@@ -1,7 +1,7 @@
 #include <avr/io.h>
 
 #ifndef F_CPU
-	#define F_CPU 12000000UL
+	#define F_CPU 10000000UL
 #endif
 
 #include <util/delay.h>
@@ -34,6 +34,22 @@
 #define LS_BLINK 0B00000001
 #define LS_ULINE 0B00000010
 
+//Display size used by the shadow framebuffer
+
+#ifndef LCD_COLS
+#define LCD_COLS 16
+#endif
+#ifndef LCD_ROWS
+#define LCD_ROWS 2
+#endif
+
+//Bytes buffered for the Timer1 ISR, power of two. LCDFlush() of a full
+//display queues at most LCD_ROWS*(LCD_COLS+1) bytes.
+
+#ifndef LCD_QUEUE_LEN
+#define LCD_QUEUE_LEN 64
+#endif
+
 
 
 /***************************************************
@@ -46,13 +62,18 @@ void InitLCD();
 void LCDWriteString(const char *msg);
 void LCDWriteInt(int val,unsigned int field_length);
 void LCDGotoXY(uint8_t x,uint8_t y);
-//Low level
+//Low level, queues the byte and returns, Timer1 ISR sends it
 void LCDByte(uint8_t,uint8_t);
 #define LCDCmd(c) (LCDByte(c,0))
 #define LCDData(d) (LCDByte(d,1))
 
 void LCDBusyLoop();
 
+//Shadow framebuffer: write into RAM, LCDFlush() sends only changed cells
+void LCDFbInit();
+void LCDFbWriteString(uint8_t x,uint8_t y,const char *msg);
+void LCDFlush();
+
 
 
 
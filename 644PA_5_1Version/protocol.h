@@ -1,6 +1,7 @@
 /*
  * Protocol and sensor definitions for weather station system
- * Alignment rules:
+ * Alignment rules (the structs are built with -fpack-struct, so the padding fields below are what keeps
+ * them aligned for the receiver):
  *
  * Data type   Alignment (in bytes)
  * uint8_t     1
@@ -20,13 +21,39 @@
 /*                         This needs to be considered if ported to bid endian system.                      */
 #define USART_SYNC_BYTES 0x12345678
 
+/* COBS FRAMING (optional, instead of the sync bytes): The datagram is COBS encoded so it contains no zero bytes */
+/*                and is followed by WS_COBS_DELIMITER. A code byte n (1..255) is followed by n-1 data bytes;    */
+/*                n < 255 means a zero byte follows them unless the frame ends. Overhead is 1 byte per 254      */
+/*                data bytes plus the delimiter. A receiver that lost bytes resyncs at the next delimiter.      */
+#define WS_COBS_DELIMITER 0x00
+
+/* CHECKSUM: Every datagram ends with a CRC-16 over all bytes from the datagram header up to the crc field.   */
+/*           Reflected CCITT polynomial, start value 0xFFFF, no final xor (same as avr-libc _crc_ccitt_update). */
+/*           See ws_crc.c.                                                                                      */
+#define WS_CRC_POLY 0x8408
+#define WS_CRC_INIT 0xFFFF
+
 /* DATAGRAM DATA TYPES */
 #define WS_DG_TYPE_ACK             0x00 /* General ack for notifications */
 #define WS_DG_TYPE_SENSOR_DATA_NTF 0x01 /* Sensor data notification. Contains n sensor data blocks. */
 #define WS_DG_TYPE_TIME_DATE_REQ   0x02 /* Time and date request */
-#define WS_DG_TYPE_TIME_DATE_RSP   0x03 /* Time and date response */
+#define WS_DG_TYPE_TIME_DATE_RSP   0x03 /* Time and date response. Also sent to a node to set its clock (answered */
+                                        /* with WS_DG_TYPE_ACK). year is 0 while the node's clock is not set.  */
 #define WS_DG_TYPE_MIN_MAX_REQ     0x04 /* Time and date request */
 #define WS_DG_TYPE_MIN_MAX_RSP     0x05 /* Time and date response */
+#define WS_DG_TYPE_CAL_REQ         0x06 /* Calibration resend request. Answered with a sensor data notification */
+                                        /* containing the calibration subpackets.                              */
+#define WS_DG_TYPE_FORMAT_REQ       0x07 /* Notification format request (ws_datagram_format_t) */
+#define WS_DG_TYPE_FORMAT_RSP       0x08 /* Notification format response, format is the one the node now uses */
+#define WS_DG_TYPE_SENSOR_DATA_CNTF 0x09 /* Compact sensor data notification (WS_FORMAT_COMPACT_V1) */
+#define WS_DG_TYPE_SENSOR_DATA_BNTF 0x0A /* Batched sensor data notification (WS_FORMAT_BATCH_V1) */
+
+/* NOTIFICATION FORMATS. Nodes start with WS_FORMAT_FIXED. A receiver that wants another format sends    */
+/* WS_DG_TYPE_FORMAT_REQ; the node answers with the newest format it supports that is not newer than the */
+/* requested one.                                                                                        */
+#define WS_FORMAT_FIXED      0 /* WS_DG_TYPE_SENSOR_DATA_NTF with the ws_sensor_*_t structs */
+#define WS_FORMAT_COMPACT_V1 1 /* WS_DG_TYPE_SENSOR_DATA_CNTF, see COMPACT SENSOR DATA NOTIFICATION below */
+#define WS_FORMAT_BATCH_V1   2 /* WS_DG_TYPE_SENSOR_DATA_BNTF, see BATCHED SENSOR DATA NOTIFICATION below */
 
 /* DATAGRAM HEADER */
 typedef struct {
@@ -68,6 +95,21 @@ typedef struct {
 	uint16_t crc;
 } ws_datagram_time_date_req_t;
 
+/* Calibration resend request datagram */
+typedef struct {
+	ws_datagram_header_t header;
+	uint16_t sensor_id; /* Sensor id within the node, WS_SENSOR_ID_ALL for all sensors */
+	uint16_t crc;
+} ws_datagram_cal_req_t;
+
+/* Notification format request and response datagram */
+typedef struct {
+	ws_datagram_header_t header;
+	uint8_t format;   /* WS_FORMAT_* requested (REQ) or in use (RSP) */
+	uint8_t pad1;     /* Padding (to get 4 byte aligment) */
+	uint16_t crc;
+} ws_datagram_format_t;
+
 /* Time and date response datagram */
 typedef struct {
 	ws_datagram_header_t header;
@@ -90,6 +132,8 @@ typedef struct {
 	uint16_t crc;
 } ws_datagram_min_max_req_t;
 
+/* Min/max entry. temp is signed, in 0.1 degC. The time is when the value was first seen; year is 0 if the */
+/* node's clock was not set.                                                                              */
 typedef struct {
 	uint16_t temp;
 	uint16_t year;
@@ -103,7 +147,17 @@ typedef struct {
 	uint8_t pad3;
 } min_max_temp_t;
 
-/* Time and date response datagram */
+/* Entries of ws_datagram_min_max_resp_t.minmax_temp. Windows are the last 24 h and 12 h. */
+#define WS_MIN_MAX_MAX_OUT_24 0
+#define WS_MIN_MAX_MIN_OUT_24 1
+#define WS_MIN_MAX_MAX_IN_24  2
+#define WS_MIN_MAX_MIN_IN_24  3
+#define WS_MIN_MAX_MAX_OUT_12 4
+#define WS_MIN_MAX_MIN_OUT_12 5
+#define WS_MIN_MAX_MAX_IN_12  6
+#define WS_MIN_MAX_MIN_IN_12  7
+
+/* Min/max response datagram */
 typedef struct {
 	ws_datagram_header_t header;
 	min_max_temp_t minmax_temp[8];
@@ -136,8 +190,13 @@ typedef struct {
 #define WS_SENSOR_NFT_NULL           0x0000 /* Means end of data */
 #define WS_SENSOR_NTF_SHT1X          0x0001 /* Sensirion SHT1X temperature and humidity sensor */
 #define WS_SENSOR_NTF_BMP085         0x0002 /* Bosch BMP085 digital barometric pressure and temperature sensor */
+#define WS_SENSOR_NTF_BMP085_CAL     0x0003 /* BMP085 calibration data only */
+#define WS_SENSOR_NTF_BMP085_RAW     0x0004 /* BMP085 measurement only, calibration from an earlier WS_SENSOR_NTF_BMP085_CAL */
 #define WS_SENSOR_NTF_MODE_ID        0xFFFF /* Node id */
 
+/* Sensor id for "all sensors of the node" */
+#define WS_SENSOR_ID_ALL 0xFFFF
+
 /* SENSOR DATA STRUCTS */
 /* Sensor data header. This is mandatory in the beginning of every sensor data struct. */
 typedef struct {
@@ -187,5 +246,80 @@ typedef struct {
 	uint8_t pad3;               /* Padding to round size to 4 bytes */
 } ws_sensor_bmp085_t;
 
+/* BMP085 calibration. Sent once after start-up and when requested with WS_DG_TYPE_CAL_REQ. */
+/* Receivers keep it per node id (from WS_SENSOR_NTF_MODE_ID) and sensor id.                */
+typedef struct {
+	ws_sensor_header_t header;
+	int16_t ac1;                /* Calibration data */
+	int16_t ac2;                /* Calibration data */
+	int16_t ac3;                /* Calibration data */
+	uint16_t ac4;               /* Calibration data */
+	uint16_t ac5;               /* Calibration data */
+	uint16_t ac6;               /* Calibration data */
+	int16_t b1;                 /* Calibration data */
+	int16_t b2;                 /* Calibration data */
+	int16_t mb;                 /* Calibration data */
+	int16_t mc;                 /* Calibration data */
+	int16_t md;                 /* Calibration data */
+	uint8_t cal_tag;            /* Identifies this calibration in ws_sensor_bmp085_raw_t */
+	uint8_t pad1;               /* Padding to round size to 4 bytes */
+} ws_sensor_bmp085_cal_t;
+
+/* BMP085 measurement without calibration. If the receiver has no calibration with the */
+/* same node id, sensor id and cal_tag it should send WS_DG_TYPE_CAL_REQ.              */
+typedef struct {
+	ws_sensor_header_t header;
+	uint16_t temperature;       /* 16 bits */
+	uint8_t oversampling;       /* Valid values are [0...3] */
+	uint8_t cal_tag;            /* cal_tag of the calibration to use */
+	uint32_t pressure;          /* 16 to 19 bits */
+} ws_sensor_bmp085_raw_t;
+
+/* COMPACT SENSOR DATA NOTIFICATION DATAGRAM DESCRIPTION (WS_FORMAT_COMPACT_V1):
+ * Byte number  Content
+ * [0..3]       Datagram header: ws_datagram_header_t (datagram_type = WS_DG_TYPE_SENSOR_DATA_CNTF)
+ * [4]          Format version (WS_FORMAT_COMPACT_V1)
+ * [5...]       Node id (varint)
+ * [...]        Records: record type (1 byte), sensor id (1 byte), fields (see record types below)
+ * [...]        crc (2 bytes). The records end where the crc starts (data_len).
+ *
+ * Nothing is padded. A varint is an unsigned value in 7 bit groups, lowest group first, bit 7 set in all but
+ * the last byte. Deltas are sent as varint(zigzag(value - previous value)) where zigzag(d) = (d << 1) ^ (d >> 31)
+ * so small negative deltas stay small.
+ *
+ * The previous value is the one in the last record of the same node, record kind and sensor id. DELTA records
+ * are only usable if no CNTF or BNTF datagram from the node was lost since then (msg_id increments by one per
+ * datagram); otherwise the receiver skips them until the next ABS record. ABS records are sent for the first
+ * sample, for every WS_CNTF_KEY_INTERVAL:th sample, after a format request and when oversampling, cal_tag or
+ * resolution_setting changes.
+ */
+#define WS_CNTF_SHT1X_ABS        0x01 /* resolution_setting (1 byte), temperature, humidity (varints) */
+#define WS_CNTF_SHT1X_DELTA      0x02 /* temperature, humidity (deltas) */
+#define WS_CNTF_BMP085_RAW_ABS   0x03 /* oversampling (1 byte), cal_tag (1 byte), temperature, pressure (varints) */
+#define WS_CNTF_BMP085_RAW_DELTA 0x04 /* temperature, pressure (deltas) */
+#define WS_CNTF_BMP085_CAL       0x05 /* cal_tag (1 byte), ac1...md (22 bytes, little endian) */
+#define WS_CNTF_TIME             0x06 /* BNTF only: next sample, interval change in ms (zigzag varint) */
+#define WS_CNTF_TIME_SAME        0x07 /* BNTF only: next sample, same interval as the previous one */
+
+#define WS_CNTF_KEY_INTERVAL 16
+
+/* BATCHED SENSOR DATA NOTIFICATION DATAGRAM DESCRIPTION (WS_FORMAT_BATCH_V1):
+ * Byte number  Content
+ * [0..3]       Datagram header: ws_datagram_header_t (datagram_type = WS_DG_TYPE_SENSOR_DATA_BNTF)
+ * [4]          Format version (WS_FORMAT_BATCH_V1)
+ * [5...]       Node id (varint)
+ * [...]        Age of the first sample: ms from taking it to queueing the datagram (2 bytes)
+ * [...]        Records of the first sample
+ * [...]        WS_CNTF_TIME or WS_CNTF_TIME_SAME, records of the second sample
+ * ...
+ * [...]        crc (2 bytes)
+ *
+ * Records are the compact records above. The interval of a sample is the time since the previous sample of
+ * the datagram; WS_CNTF_TIME carries it as the difference to the previous interval (which is 0 for the second
+ * sample), so periodic samples take one byte of time stamp each. A node sends the batch when it has its
+ * configured number of samples, when the oldest sample reaches its flush deadline or when the next sample
+ * would not fit.
+ */
+
 
 #endif
@@ -0,0 +1,100 @@
+/*
+*
+* Cooperative run-to-completion task scheduler
+* Tasks are released periodically from the millisecond timebase or by sched_signal().
+*
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include "timebase.h"
+#include "sched.h"
+
+static sched_task_t sched_tasks[SCHED_MAX_TASKS];
+static uint8_t sched_count;
+static volatile uint8_t sched_signals; /* Bit per task id, set by sched_signal() */
+
+#if SCHED_MAX_TASKS > 8
+#error "sched_signals has a bit for 8 tasks"
+#endif
+
+/* Add a task. First release is offset ms from now, which can be used to */
+/* keep tasks with the same period from being released on the same tick. */
+/* Returns task id (>= 0) or SCHED_ERROR_FULL.                          */
+int8_t sched_add(sched_task_fn_t fn, uint16_t period, uint16_t offset) {
+	sched_task_t *t;
+
+	if(sched_count >= SCHED_MAX_TASKS) {
+		return SCHED_ERROR_FULL;
+	}
+
+	t = &sched_tasks[sched_count];
+	t->fn = fn;
+	t->period = period;
+	t->release = timebase_ms() + offset;
+	t->overruns = 0;
+
+	return sched_count++;
+}
+
+/* Release a task now, in addition to its period. Can be called from an ISR. */
+void sched_signal(uint8_t id) {
+	uint8_t sreg = SREG;
+
+	if(id >= SCHED_MAX_TASKS) {
+		return;
+	}
+	cli();
+	sched_signals |= _BV(id);
+	SREG = sreg;
+}
+
+/* Run every task that is due or signalled once. Tasks are run in the order they were added. */
+void sched_dispatch(void) {
+	uint8_t i;
+	uint16_t now;
+	uint8_t due;
+	uint8_t sreg;
+	sched_task_t *t;
+
+	for(i = 0; i < sched_count; i++) {
+		t = &sched_tasks[i];
+		now = timebase_ms();
+		due = t->period != 0 && TIMEBASE_REACHED(now, t->release);
+		if(sched_signals & _BV(i)) {
+			sreg = SREG;
+			cli();
+			sched_signals &= ~_BV(i);
+			SREG = sreg;
+		} else if(!due) {
+			continue;
+		}
+
+		t->fn();
+		if(!due) {
+			continue;
+		}
+
+		/* Keep the release grid drift free. If a whole period has already */
+		/* passed, releases were missed: count it and resynchronize.       */
+		t->release += t->period;
+		if(TIMEBASE_REACHED(now, t->release)) {
+			t->overruns++;
+			t->release = now + t->period;
+		}
+	}
+}
+
+void sched_run(void) {
+	while(1) {
+		sched_dispatch();
+	}
+}
+
+uint16_t sched_overruns(uint8_t id) {
+	if(id >= sched_count) {
+		return 0;
+	}
+	return sched_tasks[id].overruns;
+}
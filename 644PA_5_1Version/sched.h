@@ -0,0 +1,36 @@
+/*
+*
+* Cooperative run-to-completion task scheduler
+* Tasks are released periodically from the millisecond timebase or by sched_signal().
+*
+*/
+
+#ifndef _SCHED_
+#define _SCHED_
+
+#include <stdint.h>
+
+/* Maximum number of tasks */
+#define SCHED_MAX_TASKS 8
+
+/* Return values */
+#define SCHED_OK          0
+#define SCHED_ERROR_FULL -1
+
+typedef void (*sched_task_fn_t)(void);
+
+typedef struct {
+	sched_task_fn_t fn;
+	uint16_t period;   /* Release period in ms, 0 = only when signalled */
+	uint16_t release;  /* Next release time (timebase_ms) */
+	uint16_t overruns; /* Releases missed because the previous one ran late */
+} sched_task_t;
+
+/* Function prototypes */
+int8_t sched_add(sched_task_fn_t fn, uint16_t period, uint16_t offset);
+void sched_signal(uint8_t id);
+void sched_dispatch(void);
+void sched_run(void);
+uint16_t sched_overruns(uint8_t id);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+*
+* Two digit seven segment display driver
+* Digits are multiplexed from the Timer2 compare match interrupt.
+*
+*/
+
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include "sevenseg.h"
+
+/* Segment lines are on PORTB, digit enables on PORTA */
+#define SEVENSEG_SEG_PORT   (PORTB)
+#define SEVENSEG_SEG_DDR    (DDRB)
+#define SEVENSEG_DIG_PORT   (PORTA)
+#define SEVENSEG_DIG_DDR    (DDRA)
+#define SEVENSEG_DIG0_PIN   (PA4) /* Ones */
+#define SEVENSEG_DIG1_PIN   (PA5) /* Tens */
+#define SEVENSEG_DIG_MASK   (_BV(SEVENSEG_DIG0_PIN) | _BV(SEVENSEG_DIG1_PIN))
+
+/* Timer2 runs at F_CPU/32 in CTC mode */
+#define SEVENSEG_OCR ((F_CPU / 32 / SEVENSEG_ISR_HZ) - 1)
+#if SEVENSEG_OCR > 255
+#error "SEVENSEG_ISR_HZ too low for Timer2 with prescaler 32"
+#endif
+
+static const uint8_t sevenseg_font[] PROGMEM = {
+	0x3F, 0x06, 0x5B, 0x4F, 0x66, 0x6D, 0x7D, 0x07,
+	0x7F, 0x6F, 0x77, 0x7C, 0x39, 0x5E, 0x79, 0x71
+};
+
+static const uint8_t sevenseg_enable[SEVENSEG_DIGITS] = {
+	_BV(SEVENSEG_DIG0_PIN), _BV(SEVENSEG_DIG1_PIN)
+};
+
+/* Segment patterns shown by the ISR. Written by main, read by the ISR. */
+static volatile uint8_t sevenseg_buf[SEVENSEG_DIGITS];
+static uint8_t sevenseg_cur;
+
+void sevenseg_init(void) {
+	SEVENSEG_SEG_DDR = 0xFF;
+	SEVENSEG_DIG_DDR |= SEVENSEG_DIG_MASK;
+	SEVENSEG_DIG_PORT &= ~SEVENSEG_DIG_MASK;
+
+	/* CTC mode, prescaler 32, interrupt on compare match A */
+	TCCR2A = _BV(WGM21);
+	TCCR2B = _BV(CS21) | _BV(CS20);
+	OCR2A = SEVENSEG_OCR;
+	TCNT2 = 0;
+	TIMSK2 |= _BV(OCIE2A);
+}
+
+/* Show a decimal number (0..99). Division is done here, not in the ISR. */
+void sevenseg_set_number(uint8_t num) {
+	sevenseg_buf[0] = pgm_read_byte(&sevenseg_font[num % 10]);
+	sevenseg_buf[1] = pgm_read_byte(&sevenseg_font[(num / 10) % 10]);
+}
+
+void sevenseg_set_segments(uint8_t digit, uint8_t segments) {
+	if(digit < SEVENSEG_DIGITS) {
+		sevenseg_buf[digit] = segments;
+	}
+}
+
+ISR(TIMER2_COMPA_vect) {
+	/* Blank before changing segments so the previous digit does not ghost */
+	SEVENSEG_DIG_PORT &= ~SEVENSEG_DIG_MASK;
+
+	if(++sevenseg_cur >= SEVENSEG_DIGITS) {
+		sevenseg_cur = 0;
+	}
+	SEVENSEG_SEG_PORT = sevenseg_buf[sevenseg_cur];
+	SEVENSEG_DIG_PORT |= sevenseg_enable[sevenseg_cur];
+}
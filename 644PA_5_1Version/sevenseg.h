@@ -0,0 +1,24 @@
+/*
+*
+* Two digit seven segment display driver
+* Digits are multiplexed from the Timer2 compare match interrupt.
+*
+*/
+
+#ifndef _SEVENSEG_
+#define _SEVENSEG_
+
+#include <stdint.h>
+
+/* Number of multiplexed digits */
+#define SEVENSEG_DIGITS 2
+
+/* Digit switch rate in Hz. Every digit is refreshed at SEVENSEG_ISR_HZ / SEVENSEG_DIGITS. */
+#define SEVENSEG_ISR_HZ 2000
+
+/* Function prototypes */
+void sevenseg_init(void);
+void sevenseg_set_number(uint8_t num);
+void sevenseg_set_segments(uint8_t digit, uint8_t segments);
+
+#endif
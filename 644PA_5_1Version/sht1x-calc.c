@@ -0,0 +1,156 @@
+/*
+*
+* Sensirion SHT1X conversion and checksum
+* Raw readings to temperature and relative humidity in integer math. The temperature is
+* exact, the humidity is within 0.0075 %RH of the datasheet formula for every reading of
+* both resolutions. Readings are checked against the CRC-8 the sensor sends after them,
+* with a 256 entry table or a 16 entry one (SHT1X_CRC_NIBBLE).
+*
+* The file also builds on the host (host/Makefile), where ws_sht1x_check sweeps all
+* readings against the float formulas and checks both CRC tables against the bitwise
+* CRC-8.
+*
+*/
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+#include "sht1x-calc.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define SHT1X_CRC_BYTE_TABLE   (!SHT1X_CRC_NIBBLE)
+#define SHT1X_CRC_NIBBLE_TABLE (SHT1X_CRC_NIBBLE)
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define SHT1X_CRC_BYTE_TABLE   1
+#define SHT1X_CRC_NIBBLE_TABLE 1
+#endif
+
+#if SHT1X_CRC_NIBBLE
+#define SHT1X_CRC_UPDATE sht1x_crc_update_nibble
+#else
+#define SHT1X_CRC_UPDATE sht1x_crc_update_byte
+#endif
+
+/* Humidity conversion, RH = c1 + c2 * SOrh + c3 * SOrh^2 + (T - 25) * (t1 + t2 * SOrh):     */
+/*            c1        c2        c3            t1      t2                                  */
+/*   12 bit   -2.0468   0.0367    -1.5955E-6    0.01    0.00008                             */
+/*    8 bit   -2.0468   0.5872    -4.0845E-4    0.01    0.00128                             */
+/* The 8 bit set is the 12 bit one with SOrh * 16, and d2 for 12 bit temperature (0.04) is */
+/* the 14 bit one (0.01) with SOt * 4. So readings are scaled to 14/12 bits and the 12    */
+/* bit set is used, in 0.01 %RH and 1/65536 fixed point. The temperature term is worked   */
+/* out in 1/262144 and the products are rounded, that keeps it within 0.0075 %RH:         */
+#define SHT1X_C1 -13413908L /* c1 * 100 * 65536 */
+#define SHT1X_C2 240517L    /* c2 * 100 * 65536 */
+#define SHT1X_C3 10707L     /* -c3 * 100 * 65536 * 1024, with SOrh^2 / 1024 */
+#define SHT1X_T1 2621L      /* t1 * 262144 */
+#define SHT1X_T2 21475L     /* t2 * 262144 * 1024, with SOrh / 1024 */
+
+/* CRC-8 x^8 + x^5 + x^4 + 1 over the command and the data bytes, MSB first. The start */
+/* value is the low nibble of the status register, bit reversed, and the sensor sends */
+/* the result bit reversed too.                                                       */
+#if SHT1X_CRC_NIBBLE_TABLE
+/* sht1x_crc_nibble_table[i] = CRC of the 4 bit value i with a zero start value */
+static const uint8_t sht1x_crc_nibble_table[16] PROGMEM = {
+	0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+	0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E
+};
+
+uint8_t sht1x_crc_update_nibble(uint8_t crc, uint8_t data) {
+	crc = (crc << 4) ^ pgm_read_byte(&sht1x_crc_nibble_table[(crc ^ data) >> 4]);
+	crc = (crc << 4) ^ pgm_read_byte(&sht1x_crc_nibble_table[(crc >> 4) ^ (data & 0x0F)]);
+	return crc;
+}
+#endif
+
+#if SHT1X_CRC_BYTE_TABLE
+/* sht1x_crc_table[i] = CRC of byte i with a zero start value */
+static const uint8_t sht1x_crc_table[256] PROGMEM = {
+	0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
+	0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
+	0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4,
+	0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
+	0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11,
+	0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
+	0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52,
+	0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
+	0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA,
+	0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
+	0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9,
+	0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
+	0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C,
+	0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
+	0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F,
+	0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
+	0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED,
+	0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
+	0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE,
+	0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
+	0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B,
+	0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
+	0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28,
+	0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
+	0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0,
+	0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
+	0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93,
+	0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
+	0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56,
+	0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
+	0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15,
+	0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC
+};
+
+uint8_t sht1x_crc_update_byte(uint8_t crc, uint8_t data) {
+	return pgm_read_byte(&sht1x_crc_table[crc ^ data]);
+}
+#endif
+
+uint8_t sht1x_reverse(uint8_t b) {
+	b = b >> 4 | b << 4;
+	b = (b & 0xCC) >> 2 | (b & 0x33) << 2;
+	return (b & 0xAA) >> 1 | (b & 0x55) << 1;
+}
+
+/* Is data[len] the checksum of the command and data[0...len - 1], with the status */
+/* register status?                                                                  */
+bool sht1x_crc_ok(uint8_t status, uint8_t cmd, const uint8_t *data, uint8_t len) {
+	uint8_t crc = SHT1X_CRC_UPDATE(sht1x_reverse(status & 0x0F), cmd);
+	uint8_t i;
+
+	for(i = 0; i < len; i++) {
+		crc = SHT1X_CRC_UPDATE(crc, data[i]);
+	}
+	return sht1x_reverse(crc) == data[len];
+}
+
+/* Temperature in 0.01 degC */
+int16_t sht1x_calc_temperature(const ws_sensor_sht1x_t *sensor) {
+	uint16_t so = sensor->temperature;
+
+	if(sensor->resolution_setting == SHT1X_RES_12_8) {
+		so <<= 2;
+	}
+	return (int16_t)(so + SHT1X_D1);
+}
+
+/* Temperature compensated relative humidity in 0.01 %RH, 0...10000 */
+int16_t sht1x_calc_humidity(const ws_sensor_sht1x_t *sensor) {
+	int32_t so = sensor->humidity;
+	int32_t rh;
+
+	if(sensor->resolution_setting == SHT1X_RES_12_8) {
+		so <<= 4;
+	}
+	rh = SHT1X_C1 + SHT1X_C2 * so - ((so * so + 512) >> 10) * SHT1X_C3;
+	rh += ((int32_t)(sht1x_calc_temperature(sensor) - 2500) * (SHT1X_T1 + ((so * SHT1X_T2 + 512) >> 10)) + 2) >> 2;
+	rh = (rh + 32768) >> 16;
+	if(rh < 0) {
+		return 0;
+	}
+	if(rh > 10000) {
+		return 10000;
+	}
+	return rh;
+}
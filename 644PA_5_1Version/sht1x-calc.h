@@ -0,0 +1,51 @@
+/*
+*
+* Sensirion SHT1X conversion and checksum
+* Raw readings to temperature and relative humidity in integer math, and the CRC-8
+* the sensor sends after every reading.
+*
+* The file also builds on the host (host/Makefile), where ws_sht1x_check
+* checks it against the datasheet formulas and the bitwise CRC-8.
+*
+*/
+
+#ifndef _SHT1X_CALC_
+#define _SHT1X_CALC_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "protocol.h"
+
+/* 1 = 16 entry nibble table for the checksum (16 bytes flash, about twice the cycles), */
+/* 0 = 256 entry table (256 bytes)                                                     */
+#ifndef SHT1X_CRC_NIBBLE
+#define SHT1X_CRC_NIBBLE 0
+#endif
+
+/* Temperature offset d1 in 0.01 degC for the supply voltage: -4010 at 5 V, -3980 at 4 V, */
+/* -3970 at 3.5 V, -3960 at 3 V, -3940 at 2.5 V.                                          */
+#ifndef SHT1X_D1
+#define SHT1X_D1 -4010
+#endif
+
+/* Resolutions (temperature/humidity bits), same as ws_sensor_sht1x_t.resolution_setting */
+#define SHT1X_RES_14_12 0
+#define SHT1X_RES_12_8  1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function prototypes */
+uint8_t sht1x_crc_update_byte(uint8_t crc, uint8_t data);
+uint8_t sht1x_crc_update_nibble(uint8_t crc, uint8_t data);
+uint8_t sht1x_reverse(uint8_t b);
+bool sht1x_crc_ok(uint8_t status, uint8_t cmd, const uint8_t *data, uint8_t len);
+int16_t sht1x_calc_temperature(const ws_sensor_sht1x_t *sensor);
+int16_t sht1x_calc_humidity(const ws_sensor_sht1x_t *sensor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
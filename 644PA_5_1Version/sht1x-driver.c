@@ -0,0 +1,288 @@
+/*
+*
+* Sensirion SHT1X temperature and humidity sensor driver
+* Runs on the I2C driver in I2C_MODE_SHT1X. Measurements are started and then polled,
+* nothing waits for the conversion. The end of a conversion is signalled by the pin
+* change interrupt of the data line. Every reading is checked against the CRC-8 the
+* sensor sends after it.
+*
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "i2c-config.h"
+#include "i2c-driver.h"
+#include "protocol.h"
+#include "sht1x-calc.h"
+#include "sht1x-driver.h"
+#include "timebase.h"
+
+/* Commands (address bits 000 and command) */
+#define SHT1X_CMD_MEASURE_TEMP 0x03
+#define SHT1X_CMD_MEASURE_HUMI 0x05
+#define SHT1X_CMD_READ_STATUS  0x07
+#define SHT1X_CMD_WRITE_STATUS 0x06
+#define SHT1X_CMD_SOFT_RESET   0x1E
+
+/* Time in ms the sensor needs after power up and soft reset */
+#define SHT1X_RESET_MS 11
+
+/* Measurement cycle: temperature, then humidity */
+#define SHT1X_STATE_IDLE 0
+#define SHT1X_STATE_TEMP 1 /* Temperature conversion running */
+#define SHT1X_STATE_HUMI 2 /* Humidity conversion running */
+
+static uint8_t sht1x_state;
+static uint16_t sht1x_started;     /* timebase_ms() when the conversion was started */
+static uint16_t sht1x_ready_at;    /* timebase_ms() after which the sensor takes commands */
+static uint8_t sht1x_resetting;    /* sht1x_ready_at not reached yet */
+static uint8_t sht1x_status;       /* Status register as last written */
+static uint8_t sht1x_status_want;  /* Status register for the next cycle */
+static uint16_t sht1x_temperature; /* Raw values of the last cycle */
+static uint16_t sht1x_humidity;
+static volatile uint8_t sht1x_ready; /* Set by the pin change ISR */
+static sht1x_notify_fn_t sht1x_notify;
+static uint8_t sht1x_retries;      /* Measurements repeated for a bad CRC in this cycle */
+static uint16_t sht1x_crc_fails;   /* Readings with a bad CRC (wraps) */
+
+/* Is data[len] the checksum of the command and data[0...len - 1]? Counts the failures. */
+static bool sht1x_reading_ok(uint8_t cmd, const uint8_t *data, uint8_t len) {
+	if(sht1x_crc_ok(sht1x_status, cmd, data, len)) {
+		return true;
+	}
+	sht1x_crc_fails++;
+	return false;
+}
+
+/* The sensor pulls the data line low when the result is ready. Only falling */
+/* edges count: the line rises after the ack of the command.                 */
+ISR(I2C_DATA_PCINT_vect) {
+	if(i2c_data_low()) {
+		I2C_DATA_PCMSK &= ~_BV(I2C_DATA_PCINT);
+		sht1x_ready = 1;
+		if(sht1x_notify) {
+			sht1x_notify();
+		}
+	}
+}
+
+static void sht1x_irq_off(void) {
+	I2C_DATA_PCMSK &= ~_BV(I2C_DATA_PCINT);
+}
+
+/* Bus reset after an error. The next command starts with a transmission start. */
+static void sht1x_recover(void) {
+	sht1x_irq_off();
+	i2c_bus_clear();
+	sht1x_state = SHT1X_STATE_IDLE;
+}
+
+/* Send a command (and its argument). Conversions keep the transmission open */
+/* until the result has been read.                                           */
+static int8_t sht1x_command(uint8_t cmd, uint8_t arg, uint8_t len, bool stop) {
+	uint8_t data[2] = {cmd, arg};
+
+	/* Compared only until reached, TIMEBASE_REACHED() is good for 32 s */
+	if(sht1x_resetting) {
+		if(!TIMEBASE_REACHED(timebase_ms(), sht1x_ready_at)) {
+			return SHT1X_ERROR_BUSY;
+		}
+		sht1x_resetting = 0;
+	}
+	if(i2c_set_mode(I2C_MODE_SHT1X) != I2C_OK) {
+		return SHT1X_ERROR_MODE_CHANGE;
+	}
+	if(i2c_write_bytes(data, len, true, stop) != I2C_OK) {
+		sht1x_recover();
+		return SHT1X_ERROR_I2C;
+	}
+	return SHT1X_OK;
+}
+
+static int8_t sht1x_measure(uint8_t cmd, uint8_t state) {
+	int8_t rc = sht1x_command(cmd, 0, 1, false);
+
+	if(rc == SHT1X_OK) {
+		sht1x_state = state;
+		sht1x_started = timebase_ms();
+		sht1x_ready = 0;
+		PCIFR = _BV(I2C_DATA_PCIF);
+		I2C_DATA_PCMSK |= _BV(I2C_DATA_PCINT);
+	}
+	return rc;
+}
+
+/* Connection reset and soft reset. Wait 11 ms after power up before calling. */
+int8_t sht1x_init(void) {
+	sht1x_resetting = 0;
+	sht1x_irq_off();
+	PCICR |= _BV(I2C_DATA_PCIE);
+	if(i2c_set_mode(I2C_MODE_SHT1X) != I2C_OK) {
+		return SHT1X_ERROR_MODE_CHANGE;
+	}
+	sht1x_recover();
+	return sht1x_soft_reset();
+}
+
+/* Status register back to its default (14/12 bits, heater off). The sensor */
+/* takes no commands for the next 11 ms, sht1x_start() returns BUSY.        */
+int8_t sht1x_soft_reset(void) {
+	int8_t rc;
+
+	if(sht1x_state != SHT1X_STATE_IDLE) {
+		return SHT1X_ERROR_BUSY;
+	}
+	rc = sht1x_command(SHT1X_CMD_SOFT_RESET, 0, 1, true);
+	if(rc == SHT1X_OK) {
+		sht1x_status = 0;
+		sht1x_ready_at = timebase_ms() + SHT1X_RESET_MS;
+		sht1x_resetting = 1;
+	}
+	return rc;
+}
+
+int8_t sht1x_read_status(uint8_t *status) {
+	uint8_t data[2];
+	uint8_t tries;
+	int8_t rc;
+
+	if(sht1x_state != SHT1X_STATE_IDLE) {
+		return SHT1X_ERROR_BUSY;
+	}
+	for(tries = 0; tries <= SHT1X_CRC_RETRIES; tries++) {
+		rc = sht1x_command(SHT1X_CMD_READ_STATUS, 0, 1, false);
+		if(rc != SHT1X_OK) {
+			return rc;
+		}
+		/* Status byte and checksum, the NACK ends the transmission */
+		if(i2c_read_bytes(data, 2, false, true) != I2C_OK) {
+			sht1x_recover();
+			return SHT1X_ERROR_I2C;
+		}
+		if(sht1x_reading_ok(SHT1X_CMD_READ_STATUS, data, 1)) {
+			*status = data[0];
+			return SHT1X_OK;
+		}
+	}
+	return SHT1X_ERROR_CRC;
+}
+
+int8_t sht1x_write_status(uint8_t status) {
+	int8_t rc;
+
+	if(sht1x_state != SHT1X_STATE_IDLE) {
+		return SHT1X_ERROR_BUSY;
+	}
+	status &= _BV(SHT1X_STATUS_LOW_RES) | _BV(SHT1X_STATUS_NO_RELOAD) | _BV(SHT1X_STATUS_HEATER);
+	sht1x_status_want = status;
+	rc = sht1x_command(SHT1X_CMD_WRITE_STATUS, status, 2, true);
+	if(rc == SHT1X_OK) {
+		sht1x_status = status;
+	}
+	return rc;
+}
+
+/* Start a measurement cycle (temperature and humidity). Poll it with sht1x_poll(). */
+int8_t sht1x_start(void) {
+	int8_t rc;
+
+	if(sht1x_state != SHT1X_STATE_IDLE) {
+		return SHT1X_ERROR_BUSY;
+	}
+	sht1x_retries = 0;
+	/* Resolution changed or lost in a soft reset */
+	if(sht1x_status != sht1x_status_want) {
+		rc = sht1x_write_status(sht1x_status_want);
+		if(rc != SHT1X_OK) {
+			return rc;
+		}
+	}
+	return sht1x_measure(SHT1X_CMD_MEASURE_TEMP, SHT1X_STATE_TEMP);
+}
+
+/* Move the measurement cycle on. Returns SHT1X_OK once when the cycle is complete */
+/* (values for sht1x_fill()), SHT1X_PENDING while it runs or if none was started   */
+/* and an error if the cycle was given up. Only has to be called when notified     */
+/* (see sht1x_set_notify()) and now and then to notice a timeout.                  */
+int8_t sht1x_poll(void) {
+	uint8_t data[3];
+	uint8_t cmd;
+	int8_t rc;
+
+	if(sht1x_state == SHT1X_STATE_IDLE) {
+		return SHT1X_PENDING;
+	}
+	if(!sht1x_ready) {
+		if((uint16_t)(timebase_ms() - sht1x_started) >
+		   ((sht1x_status & _BV(SHT1X_STATUS_LOW_RES)) ? SHT1X_TIMEOUT_LOW_RES_MS : SHT1X_TIMEOUT_MS)) {
+			sht1x_recover();
+			return SHT1X_ERROR_TIMEOUT;
+		}
+		return SHT1X_PENDING;
+	}
+
+	/* MSB, LSB and checksum, the NACK ends the transmission */
+	if(i2c_read_bytes(data, 3, false, true) != I2C_OK) {
+		sht1x_recover();
+		return SHT1X_ERROR_I2C;
+	}
+	cmd = sht1x_state == SHT1X_STATE_TEMP ? SHT1X_CMD_MEASURE_TEMP : SHT1X_CMD_MEASURE_HUMI;
+	if(!sht1x_reading_ok(cmd, data, 2)) {
+		/* Same conversion again, a few times per cycle at most */
+		if(sht1x_retries >= SHT1X_CRC_RETRIES) {
+			sht1x_state = SHT1X_STATE_IDLE;
+			return SHT1X_ERROR_CRC;
+		}
+		sht1x_retries++;
+		rc = sht1x_measure(cmd, sht1x_state);
+		if(rc != SHT1X_OK) {
+			sht1x_state = SHT1X_STATE_IDLE;
+			return rc;
+		}
+		return SHT1X_PENDING;
+	}
+	if(sht1x_state == SHT1X_STATE_TEMP) {
+		sht1x_temperature = (uint16_t)data[0] << 8 | data[1];
+		rc = sht1x_measure(SHT1X_CMD_MEASURE_HUMI, SHT1X_STATE_HUMI);
+		if(rc != SHT1X_OK) {
+			sht1x_state = SHT1X_STATE_IDLE;
+			return rc;
+		}
+		return SHT1X_PENDING;
+	}
+	sht1x_humidity = (uint16_t)data[0] << 8 | data[1];
+	sht1x_state = SHT1X_STATE_IDLE;
+	return SHT1X_OK;
+}
+
+/* Last cycle as a sensor notification subpacket */
+void sht1x_fill(ws_sensor_sht1x_t *sensor, uint16_t sensor_id) {
+	memset(sensor, 0, sizeof(*sensor));
+	sensor->header.sensor_id = sensor_id;
+	sensor->temperature = sht1x_temperature;
+	sensor->humidity = sht1x_humidity;
+	sensor->resolution_setting = (sht1x_status & _BV(SHT1X_STATUS_LOW_RES)) ? 1 : 0;
+}
+
+/* Readings (measurements and status) dropped for a bad checksum since start-up (wraps) */
+uint16_t sht1x_crc_errors(void) {
+	return sht1x_crc_fails;
+}
+
+/* Function to call from the pin change ISR when a conversion is ready, e.g. to */
+/* release the task that calls sht1x_poll(). NULL for none.                   */
+void sht1x_set_notify(sht1x_notify_fn_t fn) {
+	sht1x_notify = fn;
+}
+
+/* Resolution from the next cycle on: SHT1X_RES_14_12 or SHT1X_RES_12_8 (about 4 times */
+/* faster). sht1x_start() writes it to the status register.                           */
+void sht1x_set_resolution(uint8_t res) {
+	sht1x_status_want &= ~_BV(SHT1X_STATUS_LOW_RES);
+	if(res == SHT1X_RES_12_8) {
+		sht1x_status_want |= _BV(SHT1X_STATUS_LOW_RES);
+	}
+}
@@ -0,0 +1,62 @@
+/*
+*
+* Sensirion SHT1X temperature and humidity sensor driver
+* Runs on the I2C driver in I2C_MODE_SHT1X. Measurements are started and then polled,
+* nothing waits for the conversion. The end of a conversion is signalled by the pin
+* change interrupt of the data line. Every reading is checked against the CRC-8 the
+* sensor sends after it.
+*
+*/
+
+#ifndef _SHT1X_DRIVER_
+#define _SHT1X_DRIVER_
+
+#include <stdint.h>
+#include "protocol.h"
+#include "sht1x-calc.h"
+
+/* Longest time in ms a measurement may take before it is given up. The datasheet gives */
+/* 320 ms for 14 bits (80 ms for 12 bits) and up to 30 % more.                          */
+#ifndef SHT1X_TIMEOUT_MS
+#define SHT1X_TIMEOUT_MS 500
+#endif
+#ifndef SHT1X_TIMEOUT_LOW_RES_MS
+#define SHT1X_TIMEOUT_LOW_RES_MS 150
+#endif
+
+/* Times a reading with a bad checksum is taken again before it is given up */
+#ifndef SHT1X_CRC_RETRIES
+#define SHT1X_CRC_RETRIES 2
+#endif
+
+/* Status register bits */
+#define SHT1X_STATUS_LOW_RES   0 /* 12/8 bit (temperature/humidity) instead of 14/12 bit */
+#define SHT1X_STATUS_NO_RELOAD 1 /* Do not reload calibration from OTP before a measurement */
+#define SHT1X_STATUS_HEATER    2 /* Heater on */
+#define SHT1X_STATUS_LOW_VOLT  6 /* Supply below 2.47 V (read only) */
+
+/* Called from the pin change ISR when a conversion is ready, see sht1x_set_notify() */
+typedef void (*sht1x_notify_fn_t)(void);
+
+/* Return values */
+#define SHT1X_OK                  0
+#define SHT1X_PENDING             1 /* Measurement not ready yet */
+#define SHT1X_ERROR_I2C          -1 /* No ack from the sensor */
+#define SHT1X_ERROR_MODE_CHANGE  -2 /* I2C driver busy with another transmission */
+#define SHT1X_ERROR_BUSY         -3 /* Measurement running or sensor still resetting */
+#define SHT1X_ERROR_TIMEOUT      -4 /* Sensor did not finish the measurement in SHT1X_TIMEOUT_MS */
+#define SHT1X_ERROR_CRC          -5 /* Bad checksum after SHT1X_CRC_RETRIES retries */
+
+/* Function prototypes */
+int8_t sht1x_init(void);
+int8_t sht1x_soft_reset(void);
+int8_t sht1x_read_status(uint8_t *status);
+int8_t sht1x_write_status(uint8_t status);
+int8_t sht1x_start(void);
+int8_t sht1x_poll(void);
+void sht1x_fill(ws_sensor_sht1x_t *sensor, uint16_t sensor_id);
+uint16_t sht1x_crc_errors(void);
+void sht1x_set_notify(sht1x_notify_fn_t fn);
+void sht1x_set_resolution(uint8_t res);
+
+#endif
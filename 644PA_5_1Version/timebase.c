@@ -0,0 +1,85 @@
+/*
+*
+* Millisecond timebase
+* Timer0 in CTC mode generates a 1 ms tick.
+*
+*/
+
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include "timebase.h"
+
+/* Timer0 runs at F_CPU/64. At 10 MHz one tick is 156 counts (0.9984 ms). */
+#define TIMEBASE_OCR ((F_CPU / 64 / 1000) - 1)
+#if TIMEBASE_OCR > 255
+#error "F_CPU too high for Timer0 with prescaler 64"
+#endif
+
+static volatile uint16_t timebase_ticks;
+
+void timebase_init(void) {
+	/* CTC mode, prescaler 64, interrupt on compare match A */
+	TCCR0A = _BV(WGM01);
+	TCCR0B = _BV(CS01) | _BV(CS00);
+	OCR0A = TIMEBASE_OCR;
+	TCNT0 = 0;
+	TIMSK0 |= _BV(OCIE0A);
+}
+
+/* Milliseconds since timebase_init(), wraps every 65.5 s */
+uint16_t timebase_ms(void) {
+	uint16_t t;
+	uint8_t sreg = SREG;
+
+	cli();
+	t = timebase_ticks;
+	SREG = sreg;
+
+	return t;
+}
+
+/* Fine time is counted in Timer0 counts (F_CPU/64, 156 per ms at 10 MHz) */
+#define TIMEBASE_FINE_PER_MS (TIMEBASE_OCR + 1)
+
+/* Time in Timer0 counts, wraps every 65536 counts (420 ms at 10 MHz) */
+uint16_t timebase_fine(void) {
+	uint16_t t;
+	uint8_t cnt;
+	uint8_t sreg = SREG;
+
+	cli();
+	t = timebase_ticks;
+	cnt = TCNT0;
+	/* Compare match happened after cli() but the tick is not counted yet */
+	if((TIFR0 & _BV(OCF0A)) && cnt < TIMEBASE_OCR / 2) {
+		t++;
+	}
+	SREG = sreg;
+
+	return t * TIMEBASE_FINE_PER_MS + cnt;
+}
+
+/* Convert microseconds to fine time, rounded up. Uses the exact counter */
+/* rate (F_CPU/64/1000000 counts per us) and not the rounded tick length. */
+uint16_t timebase_us_to_fine(uint16_t us) {
+	return ((uint32_t)us * (F_CPU / 1600) + 39999) / 40000;
+}
+
+/* Busy wait at least us microseconds (max 65535). Costs a few words of */
+/* flash for any argument, unlike _delay_ms()/_delay_us() with a       */
+/* variable argument. Needs interrupts enabled.                        */
+void timebase_delay_us(uint16_t us) {
+	uint16_t start = timebase_fine();
+	uint16_t wait = timebase_us_to_fine(us) + 1;
+
+	while((uint16_t)(timebase_fine() - start) < wait);
+}
+
+ISR(TIMER0_COMPA_vect) {
+	timebase_ticks++;
+}
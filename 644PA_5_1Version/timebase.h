@@ -0,0 +1,23 @@
+/*
+*
+* Millisecond timebase
+* Timer0 in CTC mode generates a 1 ms tick.
+*
+*/
+
+#ifndef _TIMEBASE_
+#define _TIMEBASE_
+
+#include <stdint.h>
+
+/* Function prototypes */
+void timebase_init(void);
+uint16_t timebase_ms(void);
+uint16_t timebase_fine(void);
+uint16_t timebase_us_to_fine(uint16_t us);
+void timebase_delay_us(uint16_t us);
+
+/* True when time a is at or after time b (wrap safe for differences < 32768 ms) */
+#define TIMEBASE_REACHED(a, b) ((int16_t)((uint16_t)(a) - (uint16_t)(b)) >= 0)
+
+#endif
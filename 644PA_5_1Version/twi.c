@@ -0,0 +1,187 @@
+/*
+*
+* Interrupt driven TWI (hardware I2C) master driver
+* Transactions are queued and run in the background from ISR(TWI_vect).
+*
+*/
+
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "twi.h"
+
+/* TWSR status values (master modes), see avr-libc util/twi.h */
+#define TWI_START         0x08
+#define TWI_REP_START     0x10
+#define TWI_MT_SLA_ACK    0x18
+#define TWI_MT_SLA_NACK   0x20
+#define TWI_MT_DATA_ACK   0x28
+#define TWI_MT_DATA_NACK  0x30
+#define TWI_ARB_LOST      0x38
+#define TWI_MR_SLA_ACK    0x40
+#define TWI_MR_SLA_NACK   0x48
+#define TWI_MR_DATA_ACK   0x50
+#define TWI_MR_DATA_NACK  0x58
+#define TWI_STATUS_MASK   0xF8
+
+/* TWCR values */
+#define TWI_CR_BASE  (_BV(TWEN) | _BV(TWIE) | _BV(TWINT))
+#define TWI_CR_START (TWI_CR_BASE | _BV(TWSTA))
+#define TWI_CR_STOP  (TWI_CR_BASE | _BV(TWSTO))
+#define TWI_CR_ACK   (TWI_CR_BASE | _BV(TWEA))
+#define TWI_CR_NACK  (TWI_CR_BASE)
+
+#define TWI_BITRATE (((F_CPU / TWI_FREQ) - 16) / 2)
+#if TWI_BITRATE > 255
+#error "TWI_FREQ too low for prescaler 1"
+#endif
+
+/* Pending transactions, queue[head] is the one on the bus */
+static twi_xfer_t * volatile twi_queue[TWI_QUEUE_LEN];
+static volatile uint8_t twi_head;
+static volatile uint8_t twi_count;
+
+/* Progress of the running transaction */
+static uint8_t twi_pos;
+static uint8_t twi_reading;
+
+void twi_init(void) {
+	/* Prescaler 1 */
+	TWSR = 0;
+	TWBR = TWI_BITRATE;
+	TWCR = _BV(TWEN);
+}
+
+/* Queue a transaction. Returns TWI_PENDING or TWI_ERROR_QUEUE_FULL. */
+int8_t twi_submit(twi_xfer_t *xfer) {
+	uint8_t sreg = SREG;
+
+	cli();
+	if(twi_count >= TWI_QUEUE_LEN) {
+		SREG = sreg;
+		return TWI_ERROR_QUEUE_FULL;
+	}
+
+	xfer->status = TWI_PENDING;
+	twi_queue[(twi_head + twi_count) % TWI_QUEUE_LEN] = xfer;
+	twi_count++;
+
+	/* Bus was idle: start this one now. Otherwise the ISR starts it */
+	/* when the transactions before it are finished.                  */
+	if(twi_count == 1) {
+		twi_pos = 0;
+		twi_reading = 0;
+		TWCR = TWI_CR_START;
+	}
+	SREG = sreg;
+
+	return TWI_PENDING;
+}
+
+/* Queue a transaction and wait until it has finished. Needs interrupts enabled. */
+int8_t twi_transfer(twi_xfer_t *xfer) {
+	int8_t ret = twi_submit(xfer);
+
+	if(ret != TWI_PENDING) {
+		return ret;
+	}
+	while(xfer->status == TWI_PENDING);
+
+	return xfer->status;
+}
+
+/* Finish the running transaction and stop, or stop and start the next one */
+static void twi_finish(int8_t status) {
+	twi_xfer_t *xfer = twi_queue[twi_head];
+
+	twi_head = (twi_head + 1) % TWI_QUEUE_LEN;
+	twi_count--;
+	twi_pos = 0;
+	twi_reading = 0;
+
+	if(twi_count > 0) {
+		/* STOP followed by START */
+		TWCR = TWI_CR_STOP | _BV(TWSTA);
+	} else {
+		TWCR = _BV(TWINT) | _BV(TWEN) | _BV(TWSTO);
+	}
+
+	xfer->status = status;
+	if(xfer->done != NULL) {
+		xfer->done(xfer);
+	}
+}
+
+/* Continue with the read phase or finish after the last written byte */
+static void twi_write_done(twi_xfer_t *xfer) {
+	if(xfer->rlen == 0) {
+		twi_finish(TWI_OK);
+	} else if(xfer->flags & TWI_FLAG_REPEATED_START) {
+		twi_reading = 1;
+		TWCR = TWI_CR_START;
+	} else {
+		twi_reading = 1;
+		TWCR = TWI_CR_STOP | _BV(TWSTA);
+	}
+}
+
+ISR(TWI_vect) {
+	twi_xfer_t *xfer = twi_queue[twi_head];
+
+	switch(TWSR & TWI_STATUS_MASK) {
+		case TWI_START:
+		case TWI_REP_START:
+			twi_pos = 0;
+			/* Read only transaction. With wlen and rlen both 0 the address */
+			/* is written and only the ACK is checked (bus probe).         */
+			if(!twi_reading && xfer->wlen == 0 && xfer->rlen > 0) {
+				twi_reading = 1;
+			}
+			TWDR = (xfer->addr << 1) | (twi_reading ? 1 : 0);
+			TWCR = TWI_CR_BASE;
+			break;
+
+		case TWI_MT_SLA_ACK:
+		case TWI_MT_DATA_ACK:
+			if(twi_pos < xfer->wlen) {
+				TWDR = xfer->wbuf[twi_pos++];
+				TWCR = TWI_CR_BASE;
+			} else {
+				twi_write_done(xfer);
+			}
+			break;
+
+		case TWI_MR_DATA_ACK:
+			xfer->rbuf[twi_pos++] = TWDR;
+			/* fall through */
+		case TWI_MR_SLA_ACK:
+			/* NACK the last byte */
+			TWCR = (twi_pos + 1 < xfer->rlen) ? TWI_CR_ACK : TWI_CR_NACK;
+			break;
+
+		case TWI_MR_DATA_NACK:
+			xfer->rbuf[twi_pos++] = TWDR;
+			twi_finish(TWI_OK);
+			break;
+
+		case TWI_MT_SLA_NACK:
+		case TWI_MT_DATA_NACK:
+		case TWI_MR_SLA_NACK:
+			twi_finish(TWI_ERROR_NO_ACK);
+			break;
+
+		case TWI_ARB_LOST:
+			twi_finish(TWI_ERROR_ARB_LOST);
+			break;
+
+		default:
+			/* Bus error or unexpected state. Stop releases the bus. */
+			twi_finish(TWI_ERROR_BUS);
+			break;
+	}
+}
@@ -0,0 +1,51 @@
+/*
+*
+* Interrupt driven TWI (hardware I2C) master driver
+* Transactions are queued and run in the background from ISR(TWI_vect).
+*
+*/
+
+#ifndef _TWI_
+#define _TWI_
+
+#include <stdint.h>
+
+/* Bus clock in Hz */
+#define TWI_FREQ 100000UL
+
+/* Number of transactions that can be queued at the same time */
+#define TWI_QUEUE_LEN 4
+
+/* Return/status values */
+#define TWI_OK                0
+#define TWI_PENDING           1  /* Queued or running */
+#define TWI_ERROR_NO_ACK     -1
+#define TWI_ERROR_ARB_LOST   -2
+#define TWI_ERROR_BUS        -3
+#define TWI_ERROR_QUEUE_FULL -4
+
+/* Transaction flags */
+#define TWI_FLAG_REPEATED_START 0x01 /* Repeated start between write and read (else stop + start) */
+
+struct twi_xfer;
+typedef void (*twi_callback_t)(struct twi_xfer *xfer);
+
+/* Transaction descriptor. Write phase (if wlen > 0) runs first, then read phase (if rlen > 0). */
+/* The descriptor and buffers must stay valid until status is no longer TWI_PENDING.        */
+typedef struct twi_xfer {
+	uint8_t addr;           /* 7 bit slave address */
+	uint8_t flags;          /* TWI_FLAG_* */
+	const uint8_t *wbuf;    /* Bytes to write */
+	uint8_t wlen;
+	uint8_t *rbuf;          /* Buffer for read bytes */
+	uint8_t rlen;
+	volatile int8_t status; /* TWI_PENDING until done, then TWI_OK or TWI_ERROR_* */
+	twi_callback_t done;    /* Called from the ISR when finished (may be NULL) */
+} twi_xfer_t;
+
+/* Function prototypes */
+void twi_init(void);
+int8_t twi_submit(twi_xfer_t *xfer);
+int8_t twi_transfer(twi_xfer_t *xfer);
+
+#endif
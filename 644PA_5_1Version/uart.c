@@ -0,0 +1,130 @@
+/*
+*
+* Interrupt driven USART0 transmitter
+* Bytes are queued in a ring buffer and sent from ISR(USART0_UDRE_vect).
+*
+*/
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "uart.h"
+
+#define UART_TX_MASK (UART_TX_LEN - 1)
+#if (UART_TX_LEN & UART_TX_MASK) != 0 || UART_TX_LEN > 256
+#error "UART_TX_LEN must be a power of two not larger than 256"
+#endif
+
+static int uart_stdio_putchar(char c, FILE *stream);
+static FILE uart_stdout = FDEV_SETUP_STREAM(uart_stdio_putchar, NULL, _FDEV_SETUP_WRITE);
+
+/* Written by uart_putc() at head, read by the ISR at tail */
+static uint8_t uart_tx_buf[UART_TX_LEN];
+static volatile uint8_t uart_tx_head;
+static volatile uint8_t uart_tx_tail;
+static volatile uint16_t uart_dropped;
+
+void uart_init(unsigned int ubrr) {
+	uart_tx_head = 0;
+	uart_tx_tail = 0;
+	uart_dropped = 0;
+
+	/* Set baud rate */
+	UBRR0H = ubrr >> 8;
+	UBRR0L = ubrr;
+
+	/* Enable receiver and transmitter, UDRIE0 is set when there is data */
+	UCSR0A = 0;
+	UCSR0B = _BV(RXEN0) | _BV(TXEN0);
+
+	/* Frame format: 8 bit, no parity, 1 stop bit */
+	UCSR0C = _BV(UCSZ00) | _BV(UCSZ01);
+
+	stdout = &uart_stdout;
+}
+
+/* Queue a byte. Returns UART_OK or UART_ERROR_FULL if it was dropped. */
+int8_t uart_putc(uint8_t c) {
+	uint8_t next = (uart_tx_head + 1) & UART_TX_MASK;
+
+	while(next == uart_tx_tail) {
+#if UART_TX_POLICY == UART_TX_BLOCK
+		/* With interrupts off the ISR can not run, send the oldest byte here */
+		if(!(SREG & _BV(SREG_I)) && (UCSR0A & _BV(UDRE0))) {
+			UDR0 = uart_tx_buf[uart_tx_tail];
+			uart_tx_tail = (uart_tx_tail + 1) & UART_TX_MASK;
+		}
+#else
+#if UART_TX_POLICY == UART_TX_COUNT
+		if(uart_dropped != 0xFFFF) {
+			uart_dropped++;
+		}
+#endif
+		return UART_ERROR_FULL;
+#endif
+	}
+
+	uart_tx_buf[uart_tx_head] = c;
+	uart_tx_head = next;
+	UCSR0B |= _BV(UDRIE0);
+	return UART_OK;
+}
+
+/* Queue len bytes. Returns the number of bytes queued. */
+uint8_t uart_write(const uint8_t *buf, uint8_t len) {
+	uint8_t i;
+
+	for(i = 0; i < len; i++) {
+		if(uart_putc(buf[i]) != UART_OK) {
+			break;
+		}
+	}
+	return i;
+}
+
+/* Number of bytes that can be queued without hitting the overflow policy */
+uint8_t uart_tx_free(void) {
+	return (uart_tx_tail - uart_tx_head - 1) & UART_TX_MASK;
+}
+
+/* Bytes dropped since uart_init() (UART_TX_COUNT only, saturates) */
+uint16_t uart_tx_dropped(void) {
+	uint16_t n;
+	uint8_t sreg = SREG;
+
+	cli();
+	n = uart_dropped;
+	SREG = sreg;
+	return n;
+}
+
+/* Wait until the buffer is empty. Needs interrupts enabled. */
+void uart_flush(void) {
+	while(uart_tx_head != uart_tx_tail) {
+	}
+}
+
+void put_char(unsigned char byte) {
+	uart_putc(byte);
+}
+
+static int uart_stdio_putchar(char c, FILE *stream) {
+	if(c == '\n') {
+		uart_putc('\r');
+	}
+	uart_putc(c);
+	return 0;
+}
+
+ISR(USART0_UDRE_vect) {
+	uint8_t tail = uart_tx_tail;
+
+	if(tail == uart_tx_head) {
+		/* Nothing left, UDRE would keep firing */
+		UCSR0B &= ~_BV(UDRIE0);
+		return;
+	}
+	UDR0 = uart_tx_buf[tail];
+	uart_tx_tail = (tail + 1) & UART_TX_MASK;
+}
@@ -0,0 +1,43 @@
+/*
+*
+* Interrupt driven USART0 transmitter
+* Bytes are queued in a ring buffer and sent from ISR(USART0_UDRE_vect).
+*
+*/
+
+#ifndef _UART_
+#define _UART_
+
+#include <stdint.h>
+
+/* Transmit buffer size in bytes, power of two, at most 256 */
+#ifndef UART_TX_LEN
+#define UART_TX_LEN 128
+#endif
+
+/* What uart_putc() does when the transmit buffer is full */
+#define UART_TX_DROP  0 /* Drop the byte */
+#define UART_TX_BLOCK 1 /* Wait until the ISR has made room */
+#define UART_TX_COUNT 2 /* Drop the byte and count it, see uart_tx_dropped() */
+
+#ifndef UART_TX_POLICY
+#define UART_TX_POLICY UART_TX_COUNT
+#endif
+
+/* Return values */
+#define UART_OK          0
+#define UART_ERROR_FULL -1
+
+/* Baud rate register value for a clock and baud rate */
+#define UART_UBRR(fosc, baud) ((unsigned int)((fosc) / 16 / (baud) - 1))
+
+/* Function prototypes */
+void uart_init(unsigned int ubrr);
+int8_t uart_putc(uint8_t c);
+uint8_t uart_write(const uint8_t *buf, uint8_t len);
+uint8_t uart_tx_free(void);
+uint16_t uart_tx_dropped(void);
+void uart_flush(void);
+void put_char(unsigned char byte);
+
+#endif
@@ -0,0 +1,130 @@
+/*
+*
+* Software clock
+* Date and time kept from the timebase. Set by the collector (WS_DG_TYPE_TIME_DATE_RSP).
+*
+*/
+
+#ifndef F_CPU
+#define F_CPU 10000000UL
+#endif
+
+#include <stdint.h>
+#include "timebase.h"
+#include "ws_clock.h"
+
+/* Time is counted in timebase_fine() counts (F_CPU/64 per second) and not in    */
+/* timebase_ms() ticks, which are 0.9984 ms long at 10 MHz (138 s a day too slow). */
+#define WS_CLOCK_FINE_PER_S (F_CPU / 64)
+
+static ws_clock_time_t ws_clock_now;
+static uint32_t ws_clock_fine;     /* Counts into the current second */
+static uint16_t ws_clock_last;     /* timebase_fine() at the last update */
+static uint32_t ws_clock_up;       /* Seconds since start, also while the clock is not set */
+static uint8_t ws_clock_sets;      /* Times set, see ws_clock_generation() */
+
+static uint8_t ws_clock_days(uint16_t year, uint8_t month) {
+	static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+
+	if(month == 2 && !(year & 3) && (year % 100 || !(year % 400))) {
+		return 29;
+	}
+	return days[month - 1];
+}
+
+static void ws_clock_next_second(void) {
+	ws_clock_time_t *t = &ws_clock_now;
+
+	if(++t->seconds < 60) {
+		return;
+	}
+	t->seconds = 0;
+	if(++t->minutes < 60) {
+		return;
+	}
+	t->minutes = 0;
+	if(++t->hours < 24) {
+		return;
+	}
+	t->hours = 0;
+	t->weekday = t->weekday < 6 ? t->weekday + 1 : 0;
+	if(++t->day <= ws_clock_days(t->year, t->month)) {
+		return;
+	}
+	t->day = 1;
+	if(++t->month <= 12) {
+		return;
+	}
+	t->month = 1;
+	t->year++;
+}
+
+/* Advance the clock. Call at least every 400 ms, timebase_fine() wraps after 420 ms. */
+void ws_clock_task(void) {
+	uint16_t now = timebase_fine();
+
+	ws_clock_fine += (uint16_t)(now - ws_clock_last);
+	ws_clock_last = now;
+	while(ws_clock_fine >= WS_CLOCK_FINE_PER_S) {
+		ws_clock_fine -= WS_CLOCK_FINE_PER_S;
+		ws_clock_up++;
+		if(ws_clock_now.year) {
+			ws_clock_next_second();
+		}
+	}
+}
+
+void ws_clock_set(const ws_clock_time_t *t) {
+	if(t->month < 1 || t->month > 12 || t->day < 1 || t->day > ws_clock_days(t->year, t->month) ||
+	   t->hours > 23 || t->minutes > 59 || t->seconds > 59 || t->milliseconds > 999) {
+		return;
+	}
+	ws_clock_now = *t;
+	ws_clock_now.weekday %= 7;
+	ws_clock_now.milliseconds = 0;
+	ws_clock_last = timebase_fine();
+	ws_clock_fine = (uint32_t)t->milliseconds * (WS_CLOCK_FINE_PER_S / 1000);
+	ws_clock_sets++;
+}
+
+/* Current time. Returns 0 (and year 0) if the clock has not been set. */
+uint8_t ws_clock_get(ws_clock_time_t *t) {
+	ws_clock_task();
+	*t = ws_clock_now;
+	t->milliseconds = ws_clock_fine / (WS_CLOCK_FINE_PER_S / 1000);
+	return ws_clock_now.year != 0;
+}
+
+/* Changes every time the clock is set. Times worked out from ws_clock_uptime() */
+/* stamps are out of date when it has changed.                               */
+uint8_t ws_clock_generation(void) {
+	return ws_clock_sets;
+}
+
+/* Seconds since start. Counts also while the clock is not set. */
+uint32_t ws_clock_uptime(void) {
+	ws_clock_task();
+	return ws_clock_up;
+}
+
+/* Move t back by seconds (milliseconds are left as they are) */
+void ws_clock_back(ws_clock_time_t *t, uint32_t seconds) {
+	uint32_t sod = (uint32_t)t->hours * 3600 + t->minutes * 60 + t->seconds;
+
+	while(seconds > sod) {
+		seconds -= sod + 1;
+		sod = 86399;
+		t->weekday = t->weekday ? t->weekday - 1 : 6;
+		if(--t->day == 0) {
+			if(--t->month == 0) {
+				t->month = 12;
+				t->year--;
+			}
+			t->day = ws_clock_days(t->year, t->month);
+		}
+	}
+	sod -= seconds;
+	t->hours = sod / 3600;
+	t->minutes = sod / 60 % 60;
+	t->seconds = sod % 60;
+}
@@ -0,0 +1,32 @@
+/*
+*
+* Software clock
+* Date and time kept from the timebase. Set by the collector (WS_DG_TYPE_TIME_DATE_RSP).
+*
+*/
+
+#ifndef _WS_CLOCK_
+#define _WS_CLOCK_
+
+#include <stdint.h>
+
+typedef struct {
+	uint16_t year;         /* 0 = clock not set */
+	uint8_t month;         /* 1...12 */
+	uint8_t day;           /* 1...31 */
+	uint8_t weekday;       /* 0...6, counted on from the value set */
+	uint8_t hours;
+	uint8_t minutes;
+	uint8_t seconds;
+	uint16_t milliseconds;
+} ws_clock_time_t;
+
+/* Function prototypes */
+void ws_clock_task(void);
+void ws_clock_set(const ws_clock_time_t *t);
+uint8_t ws_clock_get(ws_clock_time_t *t);
+uint8_t ws_clock_generation(void);
+uint32_t ws_clock_uptime(void);
+void ws_clock_back(ws_clock_time_t *t, uint32_t seconds);
+
+#endif
@@ -0,0 +1,37 @@
+/*
+*
+* CRC-16 used by all datagrams (see WS_CRC_POLY in protocol.h)
+*
+*/
+
+#ifndef _WS_CRC_
+#define _WS_CRC_
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* 1 = 16 entry nibble table (32 bytes flash, about twice the cycles), 0 = 256 entry table (512 bytes) */
+#ifndef WS_CRC_NIBBLE
+#define WS_CRC_NIBBLE 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function prototypes */
+uint16_t ws_crc_update_byte(uint16_t crc, uint8_t data);
+uint16_t ws_crc_update_nibble(uint16_t crc, uint8_t data);
+uint16_t ws_crc_block(uint16_t crc, const void *p, uint16_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if WS_CRC_NIBBLE
+#define ws_crc_update(crc, data) ws_crc_update_nibble(crc, data)
+#else
+#define ws_crc_update(crc, data) ws_crc_update_byte(crc, data)
+#endif
+
+#endif
@@ -0,0 +1,147 @@
+/*
+*
+* Request dispatcher
+* Answers the datagrams ws_rx has received (see protocol.h for the request/response pairs).
+*
+*/
+
+#include <stdint.h>
+#include "protocol.h"
+#include "ws_clock.h"
+#include "ws_dispatch.h"
+#include "ws_frame.h"
+#include "ws_minmax.h"
+#include "ws_ntf.h"
+#include "ws_rx.h"
+
+static uint16_t ws_dispatch_drops;    /* Responses the UART had no room for */
+static uint16_t ws_dispatch_unknowns; /* Datagrams of unknown type or the wrong length */
+
+static void ws_dispatch_count(uint16_t *counter) {
+	if(*counter != 0xFFFF) {
+		(*counter)++;
+	}
+}
+
+static void ws_dispatch_header(ws_datagram_header_t *header, uint8_t type, uint8_t msg_id, uint8_t len) {
+	header->datagram_type = type;
+	header->msg_id = msg_id;
+	header->data_len = len - sizeof(*header);
+}
+
+static void ws_dispatch_send(void *dg, uint8_t len) {
+	if(ws_frame_send(dg, len) != WS_FRAME_OK) {
+		ws_dispatch_count(&ws_dispatch_drops);
+	}
+}
+
+static void ws_dispatch_ack(uint8_t msg_id) {
+	ws_datagram_ack_t ack;
+
+	ws_dispatch_header(&ack.header, WS_DG_TYPE_ACK, msg_id, sizeof(ack));
+	ack.pad1 = 0;
+	ack.pad2 = 0;
+	ws_dispatch_send(&ack, sizeof(ack));
+}
+
+/* Time as the software clock has it, year 0 if it has not been set */
+static void ws_dispatch_time_date(uint8_t msg_id) {
+	ws_datagram_time_date_resp_t rsp;
+	ws_clock_time_t t;
+
+	ws_clock_get(&t);
+	ws_dispatch_header(&rsp.header, WS_DG_TYPE_TIME_DATE_RSP, msg_id, sizeof(rsp));
+	rsp.year = t.year;
+	rsp.month = t.month;
+	rsp.day = t.day;
+	rsp.weekday = t.weekday;
+	rsp.hours = t.hours;
+	rsp.minutes = t.minutes;
+	rsp.seconds = t.seconds;
+	rsp.milliseconds = t.milliseconds;
+	ws_dispatch_send(&rsp, sizeof(rsp));
+}
+
+/* The collector sets the clock by sending a time and date response to the node */
+static void ws_dispatch_set_time(const ws_datagram_time_date_resp_t *rsp) {
+	ws_clock_time_t t;
+
+	t.year = rsp->year;
+	t.month = rsp->month;
+	t.day = rsp->day;
+	t.weekday = rsp->weekday;
+	t.hours = rsp->hours;
+	t.minutes = rsp->minutes;
+	t.seconds = rsp->seconds;
+	t.milliseconds = rsp->milliseconds;
+	ws_clock_set(&t);
+	ws_dispatch_ack(rsp->header.msg_id);
+}
+
+/* Answer everything ws_rx has queued. Call often enough that the queue   */
+/* (WS_RX_QUEUE - 1 datagrams, about 12 ms each at 9600 baud) never fills. */
+void ws_dispatch_poll(void) {
+	union {
+		uint8_t bytes[WS_RX_MAX_LEN];
+		ws_datagram_header_t header;
+		ws_datagram_cal_req_t cal;
+		ws_datagram_format_t format;
+		ws_datagram_time_date_resp_t time_date;
+	} dg;
+	uint8_t len;
+
+	while((len = ws_rx_get(dg.bytes)) != 0) {
+		switch(dg.header.datagram_type) {
+		case WS_DG_TYPE_TIME_DATE_REQ:
+			if(len == sizeof(ws_datagram_time_date_req_t)) {
+				ws_dispatch_time_date(dg.header.msg_id);
+				continue;
+			}
+			break;
+		case WS_DG_TYPE_MIN_MAX_REQ:
+			if(len == sizeof(ws_datagram_min_max_req_t)) {
+				ws_dispatch_send(ws_minmax_response(dg.header.msg_id), sizeof(ws_datagram_min_max_resp_t));
+				continue;
+			}
+			break;
+		case WS_DG_TYPE_CAL_REQ:
+			/* Answered by the next notification of the sensor */
+			if(len == sizeof(ws_datagram_cal_req_t)) {
+				ws_ntf_cal_request(dg.cal.sensor_id);
+				continue;
+			}
+			break;
+		case WS_DG_TYPE_FORMAT_REQ:
+			if(len == sizeof(ws_datagram_format_t)) {
+				if(ws_ntf_format_request(dg.header.msg_id, dg.format.format) != WS_NTF_OK) {
+					ws_dispatch_count(&ws_dispatch_drops);
+				}
+				continue;
+			}
+			break;
+		case WS_DG_TYPE_TIME_DATE_RSP:
+			if(len == sizeof(ws_datagram_time_date_resp_t)) {
+				ws_dispatch_set_time(&dg.time_date);
+				continue;
+			}
+			break;
+		case WS_DG_TYPE_ACK:
+			/* Notifications are not resent, nothing to do */
+			if(len == sizeof(ws_datagram_ack_t)) {
+				continue;
+			}
+			break;
+		}
+		ws_dispatch_count(&ws_dispatch_unknowns);
+	}
+}
+
+/* Responses not sent because the UART buffer was full (saturates) */
+uint16_t ws_dispatch_dropped(void) {
+	return ws_dispatch_drops;
+}
+
+/* Received datagrams that were not understood (saturates) */
+uint16_t ws_dispatch_unknown(void) {
+	return ws_dispatch_unknowns;
+}
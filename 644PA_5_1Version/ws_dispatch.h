@@ -0,0 +1,18 @@
+/*
+*
+* Request dispatcher
+* Answers the datagrams ws_rx has received (see protocol.h for the request/response pairs).
+*
+*/
+
+#ifndef _WS_DISPATCH_
+#define _WS_DISPATCH_
+
+#include <stdint.h>
+
+/* Function prototypes */
+void ws_dispatch_poll(void);
+uint16_t ws_dispatch_dropped(void);
+uint16_t ws_dispatch_unknown(void);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+*
+* Datagram framing on the UART
+* Fills in the datagram CRC and queues the datagram with sync bytes or COBS framing (see protocol.h).
+*
+*/
+
+#include <stdint.h>
+#include "protocol.h"
+#include "uart.h"
+#include "ws_crc.h"
+#include "ws_frame.h"
+
+#if WS_FRAMING == WS_FRAMING_COBS
+/* COBS: every run of up to 254 non-zero bytes goes out after a code byte */
+/* (run length + 1). A code below 0xFF stands for a zero after the run,   */
+/* except at the end of the datagram. The encoder reads ahead in the      */
+/* datagram, so no second buffer is needed.                               */
+static void ws_frame_put(const uint8_t *p, uint8_t len) {
+	const uint8_t *end = p + len;
+	const uint8_t *run;
+	uint8_t code;
+
+	for(;;) {
+		run = p;
+		code = 1;
+		while(p < end && *p != 0 && code < 0xFF) {
+			p++;
+			code++;
+		}
+		uart_putc(code);
+		uart_write(run, code - 1);
+		if(p >= end) {
+			break;
+		}
+		if(code != 0xFF) {
+			p++; /* The zero is implied by the code */
+		}
+	}
+	uart_putc(WS_COBS_DELIMITER);
+}
+#else
+static void ws_frame_put(const uint8_t *p, uint8_t len) {
+	uint32_t sync = USART_SYNC_BYTES;
+	uint8_t i;
+
+	/* Sync bytes go out little endian like the rest of the datagram */
+	for(i = 0; i < 4; i++) {
+		uart_putc(sync & 0xFF);
+		sync >>= 8;
+	}
+	uart_write(p, len);
+}
+#endif
+
+/* Fill in the crc (last two bytes of every datagram) and queue dg. */
+/* The datagram is queued whole or not at all, so the receiver      */
+/* never sees half a datagram.                                      */
+int8_t ws_frame_send(uint8_t *dg, uint8_t len) {
+	uint16_t crc = ws_crc_block(WS_CRC_INIT, dg, len - 2);
+
+	dg[len - 2] = crc & 0xFF;
+	dg[len - 1] = crc >> 8;
+
+	if(uart_tx_free() < WS_FRAME_MAX_LEN(len)) {
+		return WS_FRAME_ERROR_UART;
+	}
+	ws_frame_put(dg, len);
+	return WS_FRAME_OK;
+}
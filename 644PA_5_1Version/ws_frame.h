@@ -0,0 +1,36 @@
+/*
+*
+* Datagram framing on the UART
+* Fills in the datagram CRC and queues the datagram with sync bytes or COBS framing (see protocol.h).
+*
+*/
+
+#ifndef _WS_FRAME_
+#define _WS_FRAME_
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* Framing used for sending */
+#define WS_FRAMING_SYNC 0 /* USART_SYNC_BYTES before every datagram */
+#define WS_FRAMING_COBS 1 /* COBS encoded datagram and a WS_COBS_DELIMITER */
+
+#ifndef WS_FRAMING
+#define WS_FRAMING WS_FRAMING_SYNC
+#endif
+
+/* Bytes on the wire for a datagram of len bytes (worst case for COBS) */
+#if WS_FRAMING == WS_FRAMING_COBS
+#define WS_FRAME_MAX_LEN(len) ((len) + (len) / 254 + 2)
+#else
+#define WS_FRAME_MAX_LEN(len) ((len) + 4)
+#endif
+
+/* Return values */
+#define WS_FRAME_OK          0
+#define WS_FRAME_ERROR_UART -1 /* Not enough room in the UART buffer, nothing queued */
+
+/* Function prototypes */
+int8_t ws_frame_send(uint8_t *dg, uint8_t len);
+
+#endif
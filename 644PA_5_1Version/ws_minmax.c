@@ -0,0 +1,256 @@
+/*
+*
+* Rolling temperature minimum and maximum
+* Minimum and maximum of the last 12 h and 24 h per channel, kept ready as a WS_DG_TYPE_MIN_MAX_RSP.
+*
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "protocol.h"
+#include "ws_clock.h"
+#include "ws_minmax.h"
+
+/* Bucket indexes are 8 bit and so is the minute within a bucket (min_at, max_at) */
+#if (24 * 60) % WS_MINMAX_BUCKET_MIN != 0 || WS_MINMAX_BUCKETS % 2 != 0 || WS_MINMAX_BUCKETS > 254 || \
+    WS_MINMAX_BUCKET_MIN > 256
+#error "WS_MINMAX_BUCKET_MIN must divide 24 h into an even number of at most 254 buckets and be at most 256"
+#endif
+
+#define WS_MINMAX_N WS_MINMAX_BUCKETS
+
+/* Every sample goes to the bucket of its minute (ws_clock_uptime()). A bucket keeps   */
+/* its minimum and maximum and the minute (within the bucket) they were first seen.     */
+/* min > max means no samples.                                                          */
+typedef struct {
+	int16_t min;
+	int16_t max;
+	uint8_t min_at;
+	uint8_t max_at;
+} ws_minmax_bucket_t;
+
+/* Monotonic deques of bucket indexes, one per window and direction: the buckets that   */
+/* can still become the extreme of the window, oldest first. Each bucket is pushed and  */
+/* popped at most once per change of its extreme, so a sample costs O(1) amortized and  */
+/* the extreme of the window is always at the front.                                    */
+#define WS_MINMAX_MAX24 0
+#define WS_MINMAX_MIN24 1
+#define WS_MINMAX_MAX12 2
+#define WS_MINMAX_MIN12 3
+#define WS_MINMAX_QUEUES 4
+
+#define WS_MINMAX_IS_MIN(q) ((q) & 1)
+
+typedef struct {
+	uint8_t head;
+	uint8_t len;
+} ws_minmax_deque_t;
+
+/* The deques of a channel share one array: window length in buckets and where they start */
+static const uint8_t ws_minmax_window[WS_MINMAX_QUEUES] = {
+	WS_MINMAX_N, WS_MINMAX_N, WS_MINMAX_N / 2, WS_MINMAX_N / 2
+};
+static const uint16_t ws_minmax_base[WS_MINMAX_QUEUES] = {
+	0, WS_MINMAX_N, 2 * WS_MINMAX_N, 2 * WS_MINMAX_N + WS_MINMAX_N / 2
+};
+
+typedef struct {
+	ws_minmax_bucket_t bucket[WS_MINMAX_N];       /* Ring, bucket[cur] gets the samples */
+	uint8_t index[3 * WS_MINMAX_N];               /* Deque contents */
+	ws_minmax_deque_t deque[WS_MINMAX_QUEUES];
+	uint32_t bucket_no;                           /* Number of the current bucket since start */
+	uint8_t cur;
+	uint8_t started;
+	uint8_t dirty;                                /* Deque fronts changed, response not up to date */
+} ws_minmax_channel_t;
+
+static ws_minmax_channel_t ws_minmax_ch[WS_MINMAX_CHANNELS];
+static ws_datagram_min_max_resp_t ws_minmax_rsp;
+static uint8_t ws_minmax_clock;                   /* ws_clock_generation() the response was built with */
+
+static void ws_minmax_reset(ws_minmax_channel_t *ch) {
+	uint8_t i;
+
+	for(i = 0; i < WS_MINMAX_N; i++) {
+		ch->bucket[i].min = INT16_MAX;
+		ch->bucket[i].max = INT16_MIN;
+	}
+	memset(ch->deque, 0, sizeof(ch->deque));
+	ch->cur = 0;
+	ch->dirty = 1;
+}
+
+void ws_minmax_init(void) {
+	uint8_t c;
+
+	for(c = 0; c < WS_MINMAX_CHANNELS; c++) {
+		ws_minmax_reset(&ws_minmax_ch[c]);
+		ws_minmax_ch[c].started = 0;
+	}
+	memset(&ws_minmax_rsp, 0, sizeof(ws_minmax_rsp));
+	ws_minmax_rsp.header.datagram_type = WS_DG_TYPE_MIN_MAX_RSP;
+	ws_minmax_rsp.header.data_len = sizeof(ws_minmax_rsp) - sizeof(ws_minmax_rsp.header);
+}
+
+static uint8_t *ws_minmax_at(ws_minmax_channel_t *ch, uint8_t q, uint8_t pos) {
+	uint16_t i = (uint16_t)pos + ch->deque[q].head;
+
+	if(i >= ws_minmax_window[q]) {
+		i -= ws_minmax_window[q];
+	}
+	return &ch->index[ws_minmax_base[q] + i];
+}
+
+/* Buckets between b and the current one */
+static uint8_t ws_minmax_age(const ws_minmax_channel_t *ch, uint8_t b) {
+	return ch->cur >= b ? ch->cur - b : ch->cur + WS_MINMAX_N - b;
+}
+
+/* Bucket cur has a new extreme: drop the buckets it beats from the back and append it. */
+/* Older buckets with the same value stay, so the first time it was seen is reported.   */
+static void ws_minmax_push(ws_minmax_channel_t *ch, uint8_t q) {
+	ws_minmax_deque_t *d = &ch->deque[q];
+	const ws_minmax_bucket_t *cur = &ch->bucket[ch->cur];
+	const ws_minmax_bucket_t *back;
+
+	while(d->len) {
+		back = &ch->bucket[*ws_minmax_at(ch, q, d->len - 1)];
+		if(WS_MINMAX_IS_MIN(q) ? back->min <= cur->min && back != cur : back->max >= cur->max && back != cur) {
+			break;
+		}
+		d->len--;
+	}
+	*ws_minmax_at(ch, q, d->len++) = ch->cur;
+	if(d->len == 1) {
+		ch->dirty = 1;
+	}
+}
+
+/* Move on to the next bucket, dropping the ones that leave the windows */
+static void ws_minmax_next(ws_minmax_channel_t *ch) {
+	ws_minmax_deque_t *d;
+	uint8_t q;
+
+	for(q = 0; q < WS_MINMAX_QUEUES; q++) {
+		d = &ch->deque[q];
+		if(d->len && ws_minmax_age(ch, *ws_minmax_at(ch, q, 0)) >= ws_minmax_window[q] - 1) {
+			d->head = d->head + 1 < ws_minmax_window[q] ? d->head + 1 : 0;
+			d->len--;
+			ch->dirty = 1;
+		}
+	}
+	ch->cur = ch->cur + 1 < WS_MINMAX_N ? ch->cur + 1 : 0;
+	ch->bucket[ch->cur].min = INT16_MAX;
+	ch->bucket[ch->cur].max = INT16_MIN;
+	ch->bucket_no++;
+}
+
+/* Move the channel on to bucket no, starting over after 24 h without samples */
+static void ws_minmax_advance(ws_minmax_channel_t *ch, uint32_t no) {
+	if(no - ch->bucket_no >= WS_MINMAX_N) {
+		ws_minmax_reset(ch);
+		ch->bucket_no = no;
+	}
+	while(ch->bucket_no != no) {
+		ws_minmax_next(ch);
+	}
+}
+
+/* Response entry of a deque front */
+static void ws_minmax_entry(const ws_minmax_channel_t *ch, uint8_t c, uint8_t q, const ws_clock_time_t *now,
+			    uint32_t now_s) {
+	/* Entry order of ws_datagram_min_max_resp_t: 24 h before 12 h, outdoor before indoor, max before min */
+	min_max_temp_t *e = &ws_minmax_rsp.minmax_temp[(q >> 1) * 4 + c * 2 + WS_MINMAX_IS_MIN(q)];
+	const ws_minmax_bucket_t *b;
+	ws_clock_time_t t;
+	uint32_t minute;
+	uint8_t i;
+
+	memset(e, 0, sizeof(*e));
+	if(!ch->deque[q].len) {
+		return;
+	}
+	i = ch->index[ws_minmax_base[q] + ch->deque[q].head];
+	b = &ch->bucket[i];
+	e->temp = WS_MINMAX_IS_MIN(q) ? b->min : b->max;
+	e->valid = 1;
+	if(!now->year) {
+		return;
+	}
+	minute = (ch->bucket_no - ws_minmax_age(ch, i)) * WS_MINMAX_BUCKET_MIN +
+		 (WS_MINMAX_IS_MIN(q) ? b->min_at : b->max_at);
+	t = *now;
+	ws_clock_back(&t, now_s - minute * 60);
+	e->year = t.year;
+	e->month = t.month;
+	e->day = t.day;
+	e->weekday = t.weekday;
+	e->hours = t.hours;
+	e->minutes = t.minutes;
+}
+
+/* Rebuild the entries that changed, all of them if the clock was set. Channels without */
+/* recent samples are moved on first, so old buckets leave the windows in time.       */
+static void ws_minmax_build(void) {
+	ws_clock_time_t now;
+	uint32_t now_s;
+	uint8_t all = ws_minmax_clock != ws_clock_generation();
+	uint8_t c, q;
+
+	ws_clock_get(&now);
+	now_s = ws_clock_uptime();
+	for(c = 0; c < WS_MINMAX_CHANNELS; c++) {
+		if(ws_minmax_ch[c].started) {
+			ws_minmax_advance(&ws_minmax_ch[c], now_s / 60 / WS_MINMAX_BUCKET_MIN);
+		}
+		if(!ws_minmax_ch[c].dirty && !all) {
+			continue;
+		}
+		for(q = 0; q < WS_MINMAX_QUEUES; q++) {
+			ws_minmax_entry(&ws_minmax_ch[c], c, q, &now, now_s);
+		}
+		ws_minmax_ch[c].dirty = 0;
+	}
+	ws_minmax_clock = ws_clock_generation();
+}
+
+/* Add a temperature sample (0.1 degC) */
+void ws_minmax_add(uint8_t channel, int16_t temp) {
+	ws_minmax_channel_t *ch;
+	ws_minmax_bucket_t *b;
+	uint32_t minute = ws_clock_uptime() / 60;
+	uint32_t no = minute / WS_MINMAX_BUCKET_MIN;
+
+	if(channel >= WS_MINMAX_CHANNELS) {
+		return;
+	}
+	ch = &ws_minmax_ch[channel];
+	if(!ch->started) {
+		ws_minmax_reset(ch);
+		ch->bucket_no = no;
+		ch->started = 1;
+	}
+	ws_minmax_advance(ch, no);
+
+	b = &ch->bucket[ch->cur];
+	if(temp > b->max) {
+		b->max = temp;
+		b->max_at = minute - no * WS_MINMAX_BUCKET_MIN;
+		ws_minmax_push(ch, WS_MINMAX_MAX24);
+		ws_minmax_push(ch, WS_MINMAX_MAX12);
+	}
+	if(temp < b->min) {
+		b->min = temp;
+		b->min_at = minute - no * WS_MINMAX_BUCKET_MIN;
+		ws_minmax_push(ch, WS_MINMAX_MIN24);
+		ws_minmax_push(ch, WS_MINMAX_MIN12);
+	}
+	ws_minmax_build();
+}
+
+/* WS_DG_TYPE_MIN_MAX_RSP for a request, ready for ws_frame_send() */
+ws_datagram_min_max_resp_t *ws_minmax_response(uint8_t msg_id) {
+	ws_minmax_build();
+	ws_minmax_rsp.header.msg_id = msg_id;
+	return &ws_minmax_rsp;
+}
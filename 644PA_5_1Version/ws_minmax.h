@@ -0,0 +1,32 @@
+/*
+*
+* Rolling temperature minimum and maximum
+* Minimum and maximum of the last 12 h and 24 h per channel, kept ready as a WS_DG_TYPE_MIN_MAX_RSP.
+*
+*/
+
+#ifndef _WS_MINMAX_
+#define _WS_MINMAX_
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* Bucket length in minutes. Samples are summed up per bucket, so the windows move on one */
+/* bucket at a time. RAM per channel is about 9 bytes per bucket (48 buckets by default).  */
+#ifndef WS_MINMAX_BUCKET_MIN
+#define WS_MINMAX_BUCKET_MIN 30
+#endif
+
+#define WS_MINMAX_BUCKETS (24 * 60 / WS_MINMAX_BUCKET_MIN)
+
+/* Channels */
+#define WS_MINMAX_OUTDOOR  0
+#define WS_MINMAX_INDOOR   1
+#define WS_MINMAX_CHANNELS 2
+
+/* Function prototypes */
+void ws_minmax_init(void);
+void ws_minmax_add(uint8_t channel, int16_t temp);
+ws_datagram_min_max_resp_t *ws_minmax_response(uint8_t msg_id);
+
+#endif
@@ -0,0 +1,480 @@
+/*
+*
+* Sensor data notification sender
+* Builds WS_DG_TYPE_SENSOR_DATA_NTF or, after a format request, WS_DG_TYPE_SENSOR_DATA_CNTF or
+* WS_DG_TYPE_SENSOR_DATA_BNTF datagrams (see protocol.h) and queues them on the UART.
+*
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include "protocol.h"
+#include "timebase.h"
+#include "uart.h"
+#include "ws_frame.h"
+#include "ws_ntf.h"
+
+/* Header, version, node id and age of a batched datagram */
+#define WS_NTF_BATCH_HEADER_MAX (4 + 1 + 3 + 2)
+
+#if WS_FRAME_MAX_LEN(WS_NTF_MAX_LEN) > UART_TX_LEN - 1
+#error "UART_TX_LEN too small for WS_NTF_MAX_LEN"
+#endif
+#if WS_NTF_MAX_LEN + WS_NTF_SAMPLE_MAX > 255
+#error "WS_NTF_MAX_LEN + WS_NTF_SAMPLE_MAX must fit in 255 bytes"
+#endif
+#if WS_NTF_BATCH_HEADER_MAX + WS_NTF_SAMPLE_MAX + 2 > WS_NTF_MAX_LEN
+#error "WS_NTF_MAX_LEN too small for a batch of one WS_NTF_SAMPLE_MAX sample"
+#endif
+
+/* Datagram being built, starting with ws_datagram_header_t. In the batched format the */
+/* last sample may run past WS_NTF_MAX_LEN; it is moved to the next datagram then.     */
+static uint8_t ws_ntf_buf[WS_NTF_MAX_LEN + WS_NTF_SAMPLE_MAX];
+static uint8_t ws_ntf_len;
+static uint8_t ws_ntf_msg_id;
+static uint16_t ws_ntf_drops;
+static uint8_t ws_ntf_format = WS_NTF_FORMAT;
+
+/* Batch being built (WS_FORMAT_BATCH_V1). ws_ntf_len is 0 when there is none. */
+static uint16_t ws_ntf_node;
+static uint8_t ws_ntf_samples;      /* Complete samples in the batch */
+static uint8_t ws_ntf_age_at;       /* Offset of the age field */
+static uint8_t ws_ntf_sample_at;    /* Offset of the time record of the sample being added */
+static uint8_t ws_ntf_records_at;   /* Offset of its first record */
+static uint16_t ws_ntf_first_ms;    /* Time of the first sample */
+static uint16_t ws_ntf_last_ms;     /* Time of the latest sample */
+static uint16_t ws_ntf_interval;    /* Interval to the latest sample */
+static uint8_t ws_ntf_batch_len = WS_NTF_BATCH_LEN;
+static uint16_t ws_ntf_deadline = WS_NTF_BATCH_DEADLINE;
+
+/* State of a compact record stream at one point */
+typedef struct {
+	uint8_t count;      /* Records since the last ABS record */
+	uint16_t key;       /* Key bytes (oversampling and cal_tag / resolution_setting) of the last ABS record */
+	uint32_t v[2];
+} ws_ntf_values_t;
+
+/* Previous values of the compact records, per record kind and sensor id. prev is what the */
+/* receiver has, next what it has after the complete samples of the datagram being built   */
+/* and cur what it has after the sample being added.                                       */
+typedef struct {
+	uint8_t kind;       /* WS_CNTF_*_ABS, 0 = free */
+	uint8_t sensor_id;
+	ws_ntf_values_t prev;
+	ws_ntf_values_t next;
+	ws_ntf_values_t cur;
+} ws_ntf_track_t;
+
+static ws_ntf_track_t ws_ntf_tracks[WS_NTF_TRACKS];
+
+/* Worst case record sizes (varints of 16 and 19 bit values take 3 bytes) */
+#define WS_NTF_SHT1X_MAX  (2 + 1 + 3 + 3)
+#define WS_NTF_BMP085_MAX (2 + 2 + 3 + 3)
+#define WS_NTF_CAL_LEN    (2 + 1 + 22)
+
+/* Sensor ids (bit n = id n) whose calibration has to be sent. All are sent once after start-up. */
+static volatile uint8_t ws_ntf_cal_pending = 0xFF;
+
+/* Append a subheader and its data. Room for the ending NULL subheader is always kept. */
+static int8_t ws_ntf_put(uint16_t packet_id, uint16_t hdata, const void *data, uint8_t len) {
+	ws_ntf_subheader_t sub;
+	uint8_t room = WS_NTF_MAX_LEN - ws_ntf_len;
+
+	if(packet_id != WS_SENSOR_NFT_NULL) {
+		room -= sizeof(sub);
+	}
+	if(sizeof(sub) + len > room) {
+		return WS_NTF_ERROR_FULL;
+	}
+	sub.packet_id = packet_id;
+	sub.data = hdata;
+	memcpy(&ws_ntf_buf[ws_ntf_len], &sub, sizeof(sub));
+	ws_ntf_len += sizeof(sub);
+	memcpy(&ws_ntf_buf[ws_ntf_len], data, len);
+	ws_ntf_len += len;
+	return WS_NTF_OK;
+}
+
+static uint8_t *ws_ntf_varint(uint8_t *p, uint32_t v) {
+	while(v >= 0x80) {
+		*p++ = (uint8_t)v | 0x80;
+		v >>= 7;
+	}
+	*p++ = (uint8_t)v;
+	return p;
+}
+
+static uint8_t *ws_ntf_delta(uint8_t *p, uint32_t v, uint32_t prev) {
+	int32_t d = (int32_t)(v - prev);
+
+	return ws_ntf_varint(p, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+}
+
+/* Room left for compact records, keeping room for the CRC */
+static uint8_t ws_ntf_room(void) {
+	uint8_t limit = WS_NTF_MAX_LEN;
+
+	if(ws_ntf_format == WS_FORMAT_BATCH_V1) {
+		limit = ws_ntf_sample_at + WS_NTF_SAMPLE_MAX;
+	}
+	return limit - 2 - ws_ntf_len;
+}
+
+/* Track for a record kind and sensor id. Returns NULL if all are in use. */
+static ws_ntf_track_t *ws_ntf_track(uint8_t kind, uint8_t sensor_id) {
+	ws_ntf_track_t *free = NULL;
+	uint8_t i;
+
+	for(i = 0; i < WS_NTF_TRACKS; i++) {
+		if(ws_ntf_tracks[i].kind == kind && ws_ntf_tracks[i].sensor_id == sensor_id) {
+			return &ws_ntf_tracks[i];
+		}
+		if(!free && !ws_ntf_tracks[i].kind) {
+			free = &ws_ntf_tracks[i];
+		}
+	}
+	if(free) {
+		free->kind = kind;
+		free->sensor_id = sensor_id;
+		free->prev.count = WS_CNTF_KEY_INTERVAL;
+		free->next = free->prev;
+		free->cur = free->prev;
+	}
+	return free;
+}
+
+/* Rewind every track to what the receiver has (new datagram) */
+static void ws_ntf_tracks_rebase(void) {
+	uint8_t i;
+
+	for(i = 0; i < WS_NTF_TRACKS; i++) {
+		ws_ntf_tracks[i].next = ws_ntf_tracks[i].prev;
+		ws_ntf_tracks[i].cur = ws_ntf_tracks[i].prev;
+	}
+}
+
+/* The sample being added is complete */
+static void ws_ntf_tracks_sample_done(void) {
+	uint8_t i;
+
+	for(i = 0; i < WS_NTF_TRACKS; i++) {
+		ws_ntf_tracks[i].next = ws_ntf_tracks[i].cur;
+	}
+}
+
+/* The datagram with the complete samples was queued */
+static void ws_ntf_tracks_commit(void) {
+	uint8_t i;
+
+	for(i = 0; i < WS_NTF_TRACKS; i++) {
+		ws_ntf_tracks[i].prev = ws_ntf_tracks[i].next;
+	}
+}
+
+/* Forget all previous values, the next records are ABS records */
+static void ws_ntf_tracks_reset(void) {
+	uint8_t i;
+
+	for(i = 0; i < WS_NTF_TRACKS; i++) {
+		ws_ntf_tracks[i].kind = 0;
+	}
+}
+
+/* Append an ABS or DELTA record of two values. abs_kind is the ABS record type, the DELTA */
+/* type follows it. An ABS record starts with key_len (1 or 2) key bytes, lowest first.     */
+static int8_t ws_ntf_put_pair(uint8_t abs_kind, uint8_t sensor_id, uint16_t key, uint8_t key_len,
+                              uint32_t v0, uint32_t v1, uint8_t max_len) {
+	ws_ntf_track_t *t = ws_ntf_track(abs_kind, sensor_id);
+	uint8_t *p = &ws_ntf_buf[ws_ntf_len];
+
+	if(!t) {
+		return WS_NTF_ERROR_TYPE;
+	}
+	if(max_len > ws_ntf_room()) {
+		return WS_NTF_ERROR_FULL;
+	}
+
+	if(t->cur.count >= WS_CNTF_KEY_INTERVAL - 1 || key != t->cur.key) {
+		*p++ = abs_kind;
+		*p++ = sensor_id;
+		*p++ = (uint8_t)key;
+		if(key_len > 1) {
+			*p++ = key >> 8;
+		}
+		p = ws_ntf_varint(p, v0);
+		p = ws_ntf_varint(p, v1);
+		t->cur.count = 0;
+	} else {
+		*p++ = abs_kind + 1;
+		*p++ = sensor_id;
+		p = ws_ntf_delta(p, v0, t->cur.v[0]);
+		p = ws_ntf_delta(p, v1, t->cur.v[1]);
+		t->cur.count++;
+	}
+	t->cur.key = key;
+	t->cur.v[0] = v0;
+	t->cur.v[1] = v1;
+	ws_ntf_len = p - ws_ntf_buf;
+	return WS_NTF_OK;
+}
+
+/* Convert a ws_sensor_*_t struct to a compact record */
+static int8_t ws_ntf_put_compact(uint16_t packet_id, const void *data) {
+	const ws_sensor_sht1x_t *sht = data;
+	const ws_sensor_bmp085_raw_t *raw = data;
+	const ws_sensor_bmp085_cal_t *cal = data;
+
+	switch(packet_id) {
+	case WS_SENSOR_NTF_SHT1X:
+		return ws_ntf_put_pair(WS_CNTF_SHT1X_ABS, sht->header.sensor_id, sht->resolution_setting, 1,
+		                       sht->temperature, sht->humidity, WS_NTF_SHT1X_MAX);
+	case WS_SENSOR_NTF_BMP085_RAW:
+		return ws_ntf_put_pair(WS_CNTF_BMP085_RAW_ABS, raw->header.sensor_id,
+		                       raw->oversampling | (uint16_t)raw->cal_tag << 8, 2,
+		                       raw->temperature, raw->pressure, WS_NTF_BMP085_MAX);
+	case WS_SENSOR_NTF_BMP085_CAL:
+		if(WS_NTF_CAL_LEN > ws_ntf_room()) {
+			return WS_NTF_ERROR_FULL;
+		}
+		ws_ntf_buf[ws_ntf_len++] = WS_CNTF_BMP085_CAL;
+		ws_ntf_buf[ws_ntf_len++] = cal->header.sensor_id;
+		ws_ntf_buf[ws_ntf_len++] = cal->cal_tag;
+		/* ac1...md are little endian on the AVR already */
+		memcpy(&ws_ntf_buf[ws_ntf_len], &cal->ac1, 22);
+		ws_ntf_len += 22;
+		return WS_NTF_OK;
+	}
+	return WS_NTF_ERROR_TYPE;
+}
+
+/* Write the start of a compact or batched datagram: room for the header, version and node id */
+static void ws_ntf_start(uint16_t node_id) {
+	ws_ntf_len = sizeof(ws_datagram_header_t);
+	ws_ntf_buf[ws_ntf_len++] = ws_ntf_format;
+	ws_ntf_len = ws_ntf_varint(&ws_ntf_buf[ws_ntf_len], node_id) - ws_ntf_buf;
+	if(ws_ntf_format == WS_FORMAT_BATCH_V1) {
+		ws_ntf_node = node_id;
+		ws_ntf_age_at = ws_ntf_len;
+		ws_ntf_len += 2;
+		ws_ntf_samples = 0;
+		ws_ntf_interval = 0;
+		ws_ntf_sample_at = ws_ntf_len;
+		ws_ntf_records_at = ws_ntf_len;
+	}
+}
+
+/* Fill in the header (and the batch age) of the first len bytes and queue them with a CRC */
+static int8_t ws_ntf_queue(uint8_t type, uint8_t len) {
+	ws_datagram_header_t header;
+	uint16_t age;
+
+	header.datagram_type = type;
+	header.msg_id = ws_ntf_msg_id;
+	header.data_len = len + 2 - sizeof(header);
+	memcpy(ws_ntf_buf, &header, sizeof(header));
+	if(type == WS_DG_TYPE_SENSOR_DATA_BNTF) {
+		age = timebase_ms() - ws_ntf_first_ms;
+		ws_ntf_buf[ws_ntf_age_at] = (uint8_t)age;
+		ws_ntf_buf[ws_ntf_age_at + 1] = age >> 8;
+	}
+
+	if(ws_frame_send(ws_ntf_buf, len + 2) != WS_FRAME_OK) {
+		ws_ntf_drops++;
+		return WS_NTF_ERROR_UART;
+	}
+	ws_ntf_msg_id++;
+	ws_ntf_tracks_commit();
+	return WS_NTF_OK;
+}
+
+/* Queue the complete samples of the batch, the first len bytes of the buffer. If that fails, */
+/* the receiver loses DELTA bases and possibly calibration records: start over from ABS       */
+/* records and send all calibrations again.                                                   */
+static int8_t ws_ntf_queue_batch(uint8_t len) {
+	if(ws_ntf_queue(WS_DG_TYPE_SENSOR_DATA_BNTF, len) != WS_NTF_OK) {
+		ws_ntf_tracks_reset();
+		ws_ntf_cal_request(WS_SENSOR_ID_ALL);
+		return WS_NTF_ERROR_UART;
+	}
+	return WS_NTF_OK;
+}
+
+/* Start a new datagram. The first subpacket is WS_SENSOR_NTF_MODE_ID with the node id, */
+/* in the compact format the version and node id.                                       */
+/* In the batched format this starts a sample instead, and a datagram only if there is  */
+/* no batch being built.                                                                */
+void ws_ntf_begin(uint16_t node_id) {
+	uint16_t now, interval;
+	uint8_t *p;
+
+	if(ws_ntf_format == WS_FORMAT_FIXED) {
+		ws_ntf_len = sizeof(ws_datagram_header_t);
+		ws_ntf_put(WS_SENSOR_NTF_MODE_ID, node_id, NULL, 0);
+		return;
+	}
+	if(ws_ntf_format == WS_FORMAT_COMPACT_V1) {
+		ws_ntf_tracks_rebase();
+		ws_ntf_start(node_id);
+		return;
+	}
+
+	if(ws_ntf_len && node_id != ws_ntf_node) {
+		ws_ntf_flush();
+	}
+	now = timebase_ms();
+	if(!ws_ntf_len) {
+		ws_ntf_tracks_rebase();
+		ws_ntf_start(node_id);
+		ws_ntf_first_ms = now;
+	} else {
+		p = &ws_ntf_buf[ws_ntf_len];
+		interval = now - ws_ntf_last_ms;
+		if(interval == ws_ntf_interval) {
+			*p++ = WS_CNTF_TIME_SAME;
+		} else {
+			*p++ = WS_CNTF_TIME;
+			p = ws_ntf_delta(p, interval, ws_ntf_interval);
+		}
+		ws_ntf_sample_at = ws_ntf_len;
+		ws_ntf_len = p - ws_ntf_buf;
+		ws_ntf_records_at = ws_ntf_len;
+		ws_ntf_interval = interval;
+	}
+	ws_ntf_last_ms = now;
+}
+
+/* Append a sensor subpacket. data is one of the ws_sensor_*_t structs. */
+/* In the compact formats SHT1X, BMP085_RAW and BMP085_CAL are supported. */
+int8_t ws_ntf_add(uint16_t packet_id, const void *data, uint8_t len) {
+	if(ws_ntf_format != WS_FORMAT_FIXED) {
+		return ws_ntf_put_compact(packet_id, data);
+	}
+	return ws_ntf_put(packet_id, 0, data, len);
+}
+
+/* Close the datagram with the NULL subheader and queue it (see ws_frame_send()). */
+/* The CRC goes in the data field of the NULL subheader, the last two bytes.     */
+/* In the compact format only the CRC is added.                                */
+/* In the batched format this ends the sample. The batch is queued when it has  */
+/* the configured number of samples or its deadline has passed.                 */
+int8_t ws_ntf_send(void) {
+	uint8_t from, moved, saved[2];
+
+	if(ws_ntf_format == WS_FORMAT_FIXED) {
+		ws_ntf_put(WS_SENSOR_NFT_NULL, 0, NULL, 0);
+		return ws_ntf_queue(WS_DG_TYPE_SENSOR_DATA_NTF, ws_ntf_len - 2);
+	}
+	if(ws_ntf_format == WS_FORMAT_COMPACT_V1) {
+		ws_ntf_tracks_sample_done();
+		return ws_ntf_queue(WS_DG_TYPE_SENSOR_DATA_CNTF, ws_ntf_len);
+	}
+
+	/* The sample does not fit: queue the samples before it and move it to a new batch. */
+	/* Its records stay valid, they were based on the samples just queued. The CRC goes  */
+	/* where the sample starts, so those two bytes are saved.                            */
+	if(ws_ntf_len + 2 > WS_NTF_MAX_LEN) {
+		from = ws_ntf_records_at;
+		moved = ws_ntf_len - from;
+		memcpy(saved, &ws_ntf_buf[ws_ntf_sample_at], 2);
+		if(ws_ntf_queue_batch(ws_ntf_sample_at) != WS_NTF_OK) {
+			ws_ntf_len = 0;
+			return WS_NTF_ERROR_UART;
+		}
+		memcpy(&ws_ntf_buf[ws_ntf_sample_at], saved, 2);
+		ws_ntf_start(ws_ntf_node);
+		memmove(&ws_ntf_buf[ws_ntf_len], &ws_ntf_buf[from], moved);
+		ws_ntf_len += moved;
+		ws_ntf_first_ms = ws_ntf_last_ms;
+	}
+	ws_ntf_tracks_sample_done();
+	ws_ntf_samples++;
+	ws_ntf_sample_at = ws_ntf_len;
+
+	if(ws_ntf_samples >= ws_ntf_batch_len ||
+	   TIMEBASE_REACHED(timebase_ms(), ws_ntf_first_ms + ws_ntf_deadline)) {
+		return ws_ntf_flush();
+	}
+	return WS_NTF_OK;
+}
+
+/* Queue the batch being built now. Call between samples. */
+int8_t ws_ntf_flush(void) {
+	int8_t ret;
+
+	if(ws_ntf_format != WS_FORMAT_BATCH_V1 || !ws_ntf_len) {
+		return WS_NTF_OK;
+	}
+	ret = ws_ntf_queue_batch(ws_ntf_len);
+	ws_ntf_len = 0;
+	return ret;
+}
+
+/* Queue the batch if its flush deadline has passed. Call periodically between samples. */
+int8_t ws_ntf_poll(void) {
+	if(ws_ntf_format == WS_FORMAT_BATCH_V1 && ws_ntf_len &&
+	   TIMEBASE_REACHED(timebase_ms(), ws_ntf_first_ms + ws_ntf_deadline)) {
+		return ws_ntf_flush();
+	}
+	return WS_NTF_OK;
+}
+
+/* Samples per batch (1...255) and flush deadline in ms (below 32768) for WS_FORMAT_BATCH_V1 */
+void ws_ntf_set_batch(uint8_t samples, uint16_t deadline_ms) {
+	ws_ntf_batch_len = samples ? samples : 1;
+	ws_ntf_deadline = deadline_ms;
+}
+
+/* Switch to the newest supported format not newer than format (WS_FORMAT_*). A batch being  */
+/* built is queued first. The next compact records are ABS records. Returns the format now in */
+/* use.                                                                                       */
+uint8_t ws_ntf_set_format(uint8_t format) {
+	ws_ntf_flush();
+	ws_ntf_len = 0;
+	ws_ntf_format = format >= WS_FORMAT_BATCH_V1 ? WS_FORMAT_BATCH_V1 : format;
+	ws_ntf_tracks_reset();
+	return ws_ntf_format;
+}
+
+/* Answer a WS_DG_TYPE_FORMAT_REQ: switch format and send WS_DG_TYPE_FORMAT_RSP with the same msg_id */
+int8_t ws_ntf_format_request(uint8_t msg_id, uint8_t format) {
+	ws_datagram_format_t rsp;
+
+	rsp.header.datagram_type = WS_DG_TYPE_FORMAT_RSP;
+	rsp.header.msg_id = msg_id;
+	rsp.header.data_len = sizeof(rsp) - sizeof(rsp.header);
+	rsp.format = ws_ntf_set_format(format);
+	rsp.pad1 = 0;
+	if(ws_frame_send((uint8_t *)&rsp, sizeof(rsp)) != WS_FRAME_OK) {
+		return WS_NTF_ERROR_UART;
+	}
+	return WS_NTF_OK;
+}
+
+/* Datagrams dropped because the UART buffer was full */
+uint16_t ws_ntf_dropped(void) {
+	return ws_ntf_drops;
+}
+
+/* Ask for the calibration of a sensor (or WS_SENSOR_ID_ALL) to be sent again */
+void ws_ntf_cal_request(uint16_t sensor_id) {
+	if(sensor_id == WS_SENSOR_ID_ALL) {
+		ws_ntf_cal_pending = 0xFF;
+	} else if(sensor_id < 8) {
+		ws_ntf_cal_pending |= 1 << sensor_id;
+	}
+}
+
+/* True once for every ws_ntf_cal_request(). Call ws_ntf_cal_request() again if the datagram was dropped. */
+uint8_t ws_ntf_cal_take(uint16_t sensor_id) {
+	uint8_t mask;
+
+	if(sensor_id >= 8) {
+		return 0;
+	}
+	mask = 1 << sensor_id;
+	if(!(ws_ntf_cal_pending & mask)) {
+		return 0;
+	}
+	ws_ntf_cal_pending &= ~mask;
+	return 1;
+}
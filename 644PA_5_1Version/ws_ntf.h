@@ -0,0 +1,64 @@
+/*
+*
+* Sensor data notification sender
+* Builds WS_DG_TYPE_SENSOR_DATA_NTF or, after a format request, WS_DG_TYPE_SENSOR_DATA_CNTF or
+* WS_DG_TYPE_SENSOR_DATA_BNTF datagrams (see protocol.h) and queues them on the UART.
+*
+*/
+
+#ifndef _WS_NTF_
+#define _WS_NTF_
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* Largest datagram (header to ending NULL subheader) that can be built */
+#ifndef WS_NTF_MAX_LEN
+#define WS_NTF_MAX_LEN 96
+#endif
+
+/* Largest sample (time stamp and records) in the batched format */
+#ifndef WS_NTF_SAMPLE_MAX
+#define WS_NTF_SAMPLE_MAX 48
+#endif
+
+/* Batched format: samples per datagram and the longest time in ms the first one may wait.  */
+/* Defaults for ws_ntf_set_batch(). Larger values mean less overhead per sample and more    */
+/* latency. A batch is also sent when the next sample does not fit in WS_NTF_MAX_LEN.       */
+#ifndef WS_NTF_BATCH_LEN
+#define WS_NTF_BATCH_LEN 8
+#endif
+#ifndef WS_NTF_BATCH_DEADLINE
+#define WS_NTF_BATCH_DEADLINE 10000
+#endif
+
+/* Format used until a WS_DG_TYPE_FORMAT_REQ is received */
+#ifndef WS_NTF_FORMAT
+#define WS_NTF_FORMAT WS_FORMAT_FIXED
+#endif
+
+/* Sensors (record kind and sensor id pairs) the compact format keeps previous values for */
+#ifndef WS_NTF_TRACKS
+#define WS_NTF_TRACKS 4
+#endif
+
+/* Return values */
+#define WS_NTF_OK          0
+#define WS_NTF_ERROR_FULL -1 /* Subpacket does not fit in WS_NTF_MAX_LEN */
+#define WS_NTF_ERROR_UART -2 /* Not enough room in the UART buffer, datagram dropped */
+#define WS_NTF_ERROR_TYPE -3 /* Subpacket not supported in the compact format or out of tracks */
+
+/* Function prototypes */
+void ws_ntf_begin(uint16_t node_id);
+int8_t ws_ntf_add(uint16_t packet_id, const void *data, uint8_t len);
+int8_t ws_ntf_send(void);
+int8_t ws_ntf_flush(void);
+int8_t ws_ntf_poll(void);
+void ws_ntf_set_batch(uint8_t samples, uint16_t deadline_ms);
+uint16_t ws_ntf_dropped(void);
+uint8_t ws_ntf_set_format(uint8_t format);
+int8_t ws_ntf_format_request(uint8_t msg_id, uint8_t format);
+void ws_ntf_cal_request(uint16_t sensor_id);
+uint8_t ws_ntf_cal_take(uint16_t sensor_id);
+
+#endif
@@ -0,0 +1,247 @@
+/*
+*
+* Datagram receiver
+* Unframes and checks datagrams from USART0 in ISR(USART0_RX_vect) and queues them for ws_rx_get().
+*
+* The file also builds on the host (host/Makefile), where ws_rx_feed() takes the place of the ISR
+* and ws_rx_check runs framed requests through it.
+*
+*/
+
+#ifdef __AVR__
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#endif
+#include <stdint.h>
+#include <string.h>
+#include "protocol.h"
+#include "ws_crc.h"
+#include "ws_frame.h"
+#include "ws_rx.h"
+
+#if WS_RX_QUEUE < 2 || WS_RX_MAX_LEN < 6 || WS_RX_MAX_LEN > 255
+#error "WS_RX_QUEUE must be at least 2 and WS_RX_MAX_LEN 6...255"
+#endif
+
+/* The ISR writes slot ws_rx_head and moves head on when the datagram is good, */
+/* ws_rx_get() reads slot ws_rx_tail. head == tail means nothing is queued.     */
+static uint8_t ws_rx_buf[WS_RX_QUEUE][WS_RX_MAX_LEN];
+static uint8_t ws_rx_len[WS_RX_QUEUE];
+static volatile uint8_t ws_rx_head;
+static volatile uint8_t ws_rx_tail;
+
+/* Only used by the ISR */
+static uint8_t ws_rx_pos;         /* Bytes of the datagram received */
+static uint16_t ws_rx_crc;        /* CRC over them */
+#if WS_FRAMING == WS_FRAMING_COBS
+static uint8_t ws_rx_code;        /* Code byte of the current block */
+static uint8_t ws_rx_left;        /* Data bytes left in the current block, 0 = next byte is a code byte */
+static uint8_t ws_rx_first;       /* Next code byte is the first of the frame */
+static uint8_t ws_rx_skip;        /* Wait for the delimiter: WS_RX_SKIP_* */
+
+#define WS_RX_SKIP_NONE  0
+#define WS_RX_SKIP_ERROR 1 /* Bad frame */
+#define WS_RX_SKIP_START 2 /* Started listening mid-frame, not an error */
+#else
+static uint8_t ws_rx_sync;        /* Sync bytes matched, 4 = receiving a datagram */
+static uint8_t ws_rx_want;        /* Datagram length from the header */
+#endif
+
+/* Bad frames (framing, overrun, length and crc errors) and good datagrams the queue had no room for */
+static volatile uint16_t ws_rx_error_count;
+static volatile uint16_t ws_rx_drop_count;
+
+void ws_rx_init(void) {
+#ifdef __AVR__
+	uint8_t sreg = SREG;
+#endif
+
+	ws_rx_head = 0;
+	ws_rx_tail = 0;
+	ws_rx_pos = 0;
+	ws_rx_crc = WS_CRC_INIT;
+#if WS_FRAMING == WS_FRAMING_COBS
+	ws_rx_left = 0;
+	ws_rx_first = 1;
+	ws_rx_skip = WS_RX_SKIP_START;
+#else
+	ws_rx_sync = 0;
+#endif
+
+#ifdef __AVR__
+	/* UCSR0B is also changed by uart_putc() and the UDRE ISR */
+	cli();
+	UCSR0B |= _BV(RXCIE0);
+	SREG = sreg;
+#endif
+}
+
+static void ws_rx_count(volatile uint16_t *counter) {
+	if(*counter != 0xFFFF) {
+		(*counter)++;
+	}
+}
+
+/* Append a byte. Returns 0 if the datagram gets too long. */
+static uint8_t ws_rx_put(uint8_t c) {
+	if(ws_rx_pos >= WS_RX_MAX_LEN) {
+		return 0;
+	}
+	ws_rx_buf[ws_rx_head][ws_rx_pos++] = c;
+	ws_rx_crc = ws_crc_update(ws_rx_crc, c);
+	return 1;
+}
+
+/* Whole datagram received: queue it if the length and crc are right */
+static void ws_rx_done(void) {
+	uint8_t *dg = ws_rx_buf[ws_rx_head];
+	uint8_t next;
+
+	/* Running the crc over the crc field too leaves 0 */
+	if(ws_rx_pos < sizeof(ws_datagram_header_t) + 2 ||
+	   dg[2] + (dg[3] << 8) + sizeof(ws_datagram_header_t) != ws_rx_pos || ws_rx_crc != 0) {
+		ws_rx_count(&ws_rx_error_count);
+		return;
+	}
+	next = ws_rx_head + 1 < WS_RX_QUEUE ? ws_rx_head + 1 : 0;
+	if(next == ws_rx_tail) {
+		ws_rx_count(&ws_rx_drop_count);
+		return;
+	}
+	ws_rx_len[ws_rx_head] = ws_rx_pos;
+	ws_rx_head = next;
+}
+
+#if WS_FRAMING == WS_FRAMING_COBS
+/* COBS: decoded as the bytes come, the delimiter ends the frame */
+static void ws_rx_byte(uint8_t c, uint8_t error) {
+	if(c == WS_COBS_DELIMITER) {
+		if(ws_rx_skip || error || ws_rx_left) {
+			if(ws_rx_skip != WS_RX_SKIP_START) {
+				ws_rx_count(&ws_rx_error_count);
+			}
+		} else if(ws_rx_pos) {
+			ws_rx_done();
+		}
+		ws_rx_pos = 0;
+		ws_rx_crc = WS_CRC_INIT;
+		ws_rx_left = 0;
+		ws_rx_first = 1;
+		ws_rx_skip = WS_RX_SKIP_NONE;
+		return;
+	}
+	if(ws_rx_skip) {
+		return;
+	}
+	if(error) {
+		ws_rx_skip = WS_RX_SKIP_ERROR;
+		return;
+	}
+	if(ws_rx_left == 0) {
+		/* Code byte: the block before it, if shorter than 254 bytes, stood for a zero. */
+		/* Not ws_rx_pos: a frame can start with a block of no data (code 0x01).     */
+		if(!ws_rx_first && ws_rx_code != 0xFF && !ws_rx_put(0)) {
+			ws_rx_skip = WS_RX_SKIP_ERROR;
+		}
+		ws_rx_first = 0;
+		ws_rx_code = c;
+		ws_rx_left = c - 1;
+		return;
+	}
+	ws_rx_left--;
+	if(!ws_rx_put(c)) {
+		ws_rx_skip = WS_RX_SKIP_ERROR;
+	}
+}
+#else
+/* Sync bytes: USART_SYNC_BYTES little endian, the header, then data_len bytes */
+static void ws_rx_byte(uint8_t c, uint8_t error) {
+	if(error) {
+		if(ws_rx_sync == 4) {
+			ws_rx_count(&ws_rx_error_count);
+		}
+		ws_rx_sync = 0;
+		return;
+	}
+	if(ws_rx_sync < 4) {
+		if(c == (uint8_t)(USART_SYNC_BYTES >> (8 * ws_rx_sync))) {
+			ws_rx_sync++;
+		} else {
+			ws_rx_sync = c == (uint8_t)USART_SYNC_BYTES;
+		}
+		ws_rx_pos = 0;
+		ws_rx_crc = WS_CRC_INIT;
+		ws_rx_want = WS_RX_MAX_LEN;
+		return;
+	}
+	ws_rx_put(c);
+	if(ws_rx_pos == sizeof(ws_datagram_header_t)) {
+		uint8_t *dg = ws_rx_buf[ws_rx_head];
+		/* Too long or no room for the crc: hunt for the next sync bytes */
+		if(dg[3] != 0 || dg[2] < 2 || dg[2] > WS_RX_MAX_LEN - sizeof(ws_datagram_header_t)) {
+			ws_rx_count(&ws_rx_error_count);
+			ws_rx_sync = 0;
+			return;
+		}
+		ws_rx_want = dg[2] + sizeof(ws_datagram_header_t);
+	}
+	if(ws_rx_pos == ws_rx_want) {
+		ws_rx_done();
+		ws_rx_sync = 0;
+	}
+}
+#endif
+
+#ifdef __AVR__
+/* Status is read before the data, reading UDR0 clears it */
+ISR(USART0_RX_vect) {
+	uint8_t error = UCSR0A & (_BV(FE0) | _BV(DOR0));
+	uint8_t c = UDR0;
+
+	ws_rx_byte(c, error);
+}
+#else
+/* Host builds: a byte as the ISR would get it, error for a framing or overrun error */
+void ws_rx_feed(uint8_t c, uint8_t error) {
+	ws_rx_byte(c, error);
+}
+#endif
+
+/* Copy the oldest received datagram (header to crc) to dg, WS_RX_MAX_LEN bytes. */
+/* Returns its length or 0 if nothing was received.                               */
+uint8_t ws_rx_get(uint8_t *dg) {
+	uint8_t tail = ws_rx_tail;
+	uint8_t len;
+
+	if(tail == ws_rx_head) {
+		return 0;
+	}
+	len = ws_rx_len[tail];
+	memcpy(dg, ws_rx_buf[tail], len);
+	ws_rx_tail = tail + 1 < WS_RX_QUEUE ? tail + 1 : 0;
+	return len;
+}
+
+static uint16_t ws_rx_read(volatile uint16_t *counter) {
+	uint16_t n;
+#ifdef __AVR__
+	uint8_t sreg = SREG;
+
+	cli();
+	n = *counter;
+	SREG = sreg;
+#else
+	n = *counter;
+#endif
+	return n;
+}
+
+/* Datagrams lost to line errors, bad lengths and crc errors since ws_rx_init() (saturates) */
+uint16_t ws_rx_errors(void) {
+	return ws_rx_read(&ws_rx_error_count);
+}
+
+/* Good datagrams dropped because ws_rx_get() was not called often enough (saturates) */
+uint16_t ws_rx_dropped(void) {
+	return ws_rx_read(&ws_rx_drop_count);
+}
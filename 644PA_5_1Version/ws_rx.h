@@ -0,0 +1,42 @@
+/*
+*
+* Datagram receiver
+* Unframes and checks datagrams from USART0 in ISR(USART0_RX_vect) and queues them for ws_rx_get().
+*
+*/
+
+#ifndef _WS_RX_
+#define _WS_RX_
+
+#include <stdint.h>
+#include "protocol.h"
+
+/* Largest datagram (header to crc) that is received. Requests are short, */
+/* the longest one is WS_DG_TYPE_TIME_DATE_RSP.                           */
+#ifndef WS_RX_MAX_LEN
+#define WS_RX_MAX_LEN 16
+#endif
+
+/* Datagram slots. One is the one the ISR receives into, the rest wait for ws_rx_get(). */
+#ifndef WS_RX_QUEUE
+#define WS_RX_QUEUE 4
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Function prototypes */
+void ws_rx_init(void);
+uint8_t ws_rx_get(uint8_t *dg);
+uint16_t ws_rx_errors(void);
+uint16_t ws_rx_dropped(void);
+#ifndef __AVR__
+void ws_rx_feed(uint8_t c, uint8_t error);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
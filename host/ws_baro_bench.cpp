@@ -0,0 +1,113 @@
+/*
+ * Accuracy check of the integer barometric formula
+ *
+ * Runs the firmware baro.c (built for the host) against the double
+ * formula:
+ *  - the baroTable points against (1 - y)^5.257, bound 1 Q16 count
+ *  - baroSeaLevel() over 0..13000 ft, -40..+60 C and 30..110 kPa, bound 7 Pa
+ *  - baroStandard() over 0..5540 m, bound 3 Pa
+ * and prints the largest errors. Exits with 1 if one is over its bound. The
+ * bounds and ranges are the ones documented in baro.c.
+ *
+ * Usage: ws_baro_bench
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" {
+#include "baro.h"
+}
+
+namespace {
+
+const double exponent = 5.257;
+
+struct worst {
+	double err = 0;
+	double rel = 0;
+	long a = 0, b = 0, c = 0;
+
+	void add(double e, double ref, long x, long y, long z) {
+		if(std::fabs(e) > std::fabs(err)) {
+			err = e;
+			a = x;
+			b = y;
+			c = z;
+		}
+		if(std::fabs(e / ref) > rel) {
+			rel = std::fabs(e / ref);
+		}
+	}
+};
+
+/* Q16 factor at the table points y = 0..63/512; the last point (1/8) is one past the Q19 range */
+double check_table() {
+	double max = 0;
+
+	for(int i = 0; i < 64; i++) {
+		double ref = std::fmin(std::pow(1.0 - i / 512.0, exponent) * 65536, 65535.0);
+		double e = std::fabs(baroFactor(i << 10) - ref);
+		if(e > max) {
+			max = e;
+		}
+	}
+	return max;
+}
+
+/* p / (1 - L*h / (T + L*h))^5.257 */
+worst check_sea_level() {
+	worst w;
+
+	for(long ft = 0; ft <= 13000; ft += 50) {
+		for(long t = -400; t <= 600; t += 5) {
+			for(long p = 30000; p <= 110000; p += 500) {
+				double lh = 0.0065 * ft * 0.3048;
+				double ref = p / std::pow(1 - lh / (t / 10.0 + 273.15 + lh), exponent);
+				w.add(baroSeaLevel(p, ft, t) - ref, ref, ft, t, p);
+			}
+		}
+	}
+	return w;
+}
+
+/* p0 * (1 - h/44330)^5.257 for the Q19 y the firmware uses */
+worst check_standard() {
+	worst w;
+
+	for(long m = 0; m <= 5540; m++) {
+		uint16_t y = BARO_STANDARD_Y(m);
+		double ref = SEA_LEVEL_PA * std::pow(1 - m / 44330.0, exponent);
+		w.add(baroStandard(y) - ref, ref, m, 0, 0);
+	}
+	return w;
+}
+
+} /* namespace */
+
+int main() {
+	/* Bounds the firmware documents in baro.c */
+	const double table_bound = 1.0, sea_bound = 7.0, std_bound = 3.0;
+	int rc = 0;
+
+	double table = check_table();
+	printf("table:       max error %.2f (Q16 counts)\n", table);
+	if(table > table_bound) {
+		rc = 1;
+	}
+
+	worst sea = check_sea_level();
+	printf("sea level:   max error %.1f Pa (%.1e relative) at %ld ft, %.1f C, %ld Pa\n", sea.err, sea.rel,
+	       sea.a, sea.b / 10.0, sea.c);
+	if(std::fabs(sea.err) > sea_bound) {
+		rc = 1;
+	}
+
+	worst st = check_standard();
+	printf("standard:    max error %.1f Pa at %ld m\n", st.err, st.a);
+	if(std::fabs(st.err) > std_bound) {
+		rc = 1;
+	}
+	return rc;
+}
@@ -0,0 +1,152 @@
+/*
+ * Decoder throughput benchmark
+ *
+ * Builds a synthetic capture the way the firmware sends it (sync bytes,
+ * datagram, CRC; see ws_synth.cpp), with some line noise and damaged
+ * datagrams mixed in, and decodes it with stream_decoder in read() sized
+ * chunks and with scanner over the whole buffer. Every record field is read
+ * so the views are not optimized away.
+ *
+ * Usage: ws_bench [capture MB] [rounds]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ws_decoder.h"
+#include "ws_synth.h"
+
+namespace {
+
+struct capture {
+	std::vector<uint8_t> bytes;
+	uint64_t good;
+};
+
+/* Sync framed synthetic traffic. 1 in 64 datagrams is followed by */
+/* noise and 1 in 256 has a flipped bit.                          */
+capture make_capture(size_t target) {
+	ws_synth::traffic t = ws_synth::make_traffic(target);
+	capture cap;
+	uint32_t rnd = 12345;
+
+	cap.good = 0;
+	cap.bytes.reserve(target + 4 * t.count() + 256);
+	for(size_t n = 0; n < t.count(); n++) {
+		rnd = rnd * 1103515245 + 12345;
+		for(int i = 0; i < 4; i++) {
+			cap.bytes.push_back(USART_SYNC_BYTES >> (8 * i));
+		}
+		cap.bytes.insert(cap.bytes.end(), t.datagram(n), t.datagram(n) + t.length(n));
+		if(n % 256 == 128) {
+			cap.bytes[cap.bytes.size() - 7] ^= 0x10;
+		} else {
+			cap.good++;
+		}
+		if(n % 64 == 5) {
+			for(unsigned i = 0; i < (rnd >> 27); i++) {
+				cap.bytes.push_back(rnd >> (i & 15));
+			}
+		}
+	}
+	return cap;
+}
+
+/* Reads every field of every record */
+uint64_t consume(const ws::datagram &d) {
+	uint64_t sum = d.type() + d.msg_id();
+
+	if(d.type() != WS_DG_TYPE_SENSOR_DATA_NTF) {
+		return sum;
+	}
+	for(const ws::subpacket &s : d.subpackets()) {
+		switch(s.packet_id) {
+		case WS_SENSOR_NTF_MODE_ID:
+			sum += s.data;
+			break;
+		case WS_SENSOR_NTF_BMP085_RAW: {
+			ws::bmp085_raw_view v(s.record);
+			sum += v.sensor_id() + v.temperature() + v.pressure() + v.oversampling() + v.cal_tag();
+			break;
+		}
+		case WS_SENSOR_NTF_BMP085_CAL: {
+			ws::bmp085_calibration c = ws::bmp085_cal_view(s.record).calibration();
+			sum += c.ac1 + c.ac4 + c.md;
+			break;
+		}
+		case WS_SENSOR_NTF_SHT1X: {
+			ws::sht1x_view v(s.record);
+			sum += v.sensor_id() + v.temperature() + v.humidity() + v.resolution_setting();
+			break;
+		}
+		}
+	}
+	return sum;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+void report(const char *name, double secs, size_t bytes, uint64_t datagrams) {
+	printf("%-28s %8.1f MB/s %12.0f datagrams/s\n", name, bytes / secs / 1e6, datagrams / secs);
+}
+
+} /* namespace */
+
+int main(int argc, char **argv) {
+	size_t mb = argc > 1 ? strtoul(argv[1], nullptr, 0) : 64;
+	int rounds = argc > 2 ? atoi(argv[2]) : 5;
+	const size_t chunk = 4096;
+	capture cap = make_capture(mb << 20);
+	double best_stream = 1e9, best_scan = 1e9;
+	uint64_t check = 0;
+	ws::decoder_stats st = {};
+
+	printf("capture: %zu bytes, %llu good datagrams\n", cap.bytes.size(), (unsigned long long)cap.good);
+
+	for(int r = 0; r < rounds; r++) {
+		/* stream_decoder fed like read() would, one copy from "the kernel" */
+		ws::stream_decoder dec;
+		ws::datagram d;
+		auto t0 = std::chrono::steady_clock::now();
+		for(size_t off = 0; off < cap.bytes.size(); off += chunk) {
+			size_t n = cap.bytes.size() - off < chunk ? cap.bytes.size() - off : chunk;
+			memcpy(dec.write_ptr(), &cap.bytes[off], n);
+			dec.commit(n);
+			while(dec.next(d)) {
+				check += consume(d);
+			}
+		}
+		double t = seconds_since(t0);
+		if(t < best_stream) {
+			best_stream = t;
+		}
+		st = dec.stats();
+
+		/* scanner over the whole capture, as with mmap() */
+		ws::scanner scan;
+		const uint8_t *pos = cap.bytes.data();
+		const uint8_t *end = pos + cap.bytes.size();
+		t0 = std::chrono::steady_clock::now();
+		while(scan.next(pos, end, d)) {
+			check += consume(d);
+		}
+		t = seconds_since(t0);
+		if(t < best_scan) {
+			best_scan = t;
+		}
+	}
+
+	printf("decoded: %llu datagrams, %llu crc errors, %llu length errors, %llu bytes skipped\n",
+	       (unsigned long long)st.datagrams, (unsigned long long)st.crc_errors,
+	       (unsigned long long)st.length_errors, (unsigned long long)st.skipped);
+	report("stream_decoder (4 KiB reads)", best_stream, cap.bytes.size(), st.datagrams);
+	report("scanner (whole buffer)", best_scan, cap.bytes.size(), st.datagrams);
+	fprintf(stderr, "checksum %llu\n", (unsigned long long)check);
+
+	return st.datagrams == cap.good ? 0 : 1;
+}
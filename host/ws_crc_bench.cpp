@@ -0,0 +1,113 @@
+/*
+ * CRC variant check and benchmark
+ *
+ * Checks that the firmware byte table and nibble table versions
+ * (ws_crc.c) and the host slicing-by-8 version (ws::crc16) give the same
+ * result as the bitwise definition for every length and alignment, then
+ * measures each of them.
+ *
+ * Usage: ws_crc_bench [MB per run]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ws_decoder.h"
+#include "ws_crc.h"
+
+namespace {
+
+/* The definition: one bit at a time */
+uint16_t crc_bitwise(const uint8_t *p, size_t len, uint16_t crc) {
+	while(len--) {
+		crc ^= *p++;
+		for(int b = 0; b < 8; b++) {
+			crc = (crc & 1) ? (crc >> 1) ^ WS_CRC_POLY : crc >> 1;
+		}
+	}
+	return crc;
+}
+
+uint16_t crc_byte(const uint8_t *p, size_t len, uint16_t crc) {
+	while(len--) {
+		crc = ws_crc_update_byte(crc, *p++);
+	}
+	return crc;
+}
+
+uint16_t crc_nibble(const uint8_t *p, size_t len, uint16_t crc) {
+	while(len--) {
+		crc = ws_crc_update_nibble(crc, *p++);
+	}
+	return crc;
+}
+
+uint16_t crc_slice8(const uint8_t *p, size_t len, uint16_t crc) {
+	return ws::crc16(p, len, crc);
+}
+
+typedef uint16_t (*crc_fn)(const uint8_t *, size_t, uint16_t);
+
+struct variant {
+	const char *name;
+	crc_fn fn;
+};
+
+const variant variants[] = {
+	{ "bitwise (definition)", crc_bitwise },
+	{ "nibble table (16)", crc_nibble },
+	{ "byte table (256)", crc_byte },
+	{ "slicing-by-8", crc_slice8 },
+};
+
+} /* namespace */
+
+int main(int argc, char **argv) {
+	size_t mb = argc > 1 ? strtoul(argv[1], nullptr, 0) : 64;
+	std::vector<uint8_t> buf((mb << 20) + 16);
+	uint32_t rnd = 1;
+	uint16_t ref;
+
+	for(uint8_t &b : buf) {
+		rnd = rnd * 1103515245 + 12345;
+		b = rnd >> 16;
+	}
+
+	/* "123456789" is the usual check string, CRC-16/MCRF4XX gives 0x6F91 */
+	const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+	for(const variant &v : variants) {
+		if(v.fn(check, sizeof(check), WS_CRC_INIT) != 0x6F91) {
+			printf("%s: wrong check value\n", v.name);
+			return 1;
+		}
+	}
+	for(size_t off = 0; off < 8; off++) {
+		for(size_t len = 0; len <= 1024; len++) {
+			ref = crc_bitwise(&buf[off], len, WS_CRC_INIT);
+			for(const variant &v : variants) {
+				if(v.fn(&buf[off], len, WS_CRC_INIT) != ref) {
+					printf("%s: mismatch at offset %zu length %zu\n", v.name, off, len);
+					return 1;
+				}
+			}
+		}
+	}
+	printf("all variants identical (check 0x6F91, offsets 0-7, lengths 0-1024)\n");
+
+	for(const variant &v : variants) {
+		double best = 1e9;
+		uint16_t crc = 0;
+		for(int r = 0; r < 3; r++) {
+			auto t0 = std::chrono::steady_clock::now();
+			crc = v.fn(buf.data(), mb << 20, WS_CRC_INIT);
+			double t = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+			if(t < best) {
+				best = t;
+			}
+		}
+		printf("%-22s %8.1f MB/s  (crc %04x)\n", v.name, (mb << 20) / best / 1e6, crc);
+	}
+	return 0;
+}
@@ -0,0 +1,550 @@
+/*
+ * Host side decoder for the weather station serial protocol (protocol.h)
+ */
+
+#include <cstring>
+#include <cstdint>
+#include <unistd.h>
+
+#include "ws_decoder.h"
+
+/* The views rely on the layout rules at the top of protocol.h. If one of */
+/* these fails, protocol.h has a struct that the AVR (-fpack-struct) and  */
+/* the host would lay out differently.                                    */
+static_assert(sizeof(ws_datagram_header_t) == 4, "datagram header");
+static_assert(sizeof(ws_ntf_subheader_t) == 4, "ntf subheader");
+static_assert(sizeof(ws_sensor_header_t) == 4, "sensor header");
+static_assert(sizeof(ws_datagram_ack_t) == 8, "ack");
+static_assert(sizeof(ws_datagram_cal_req_t) == 8, "cal req");
+static_assert(sizeof(ws_datagram_time_date_resp_t) == 16, "time date resp");
+static_assert(sizeof(min_max_temp_t) == 12, "min max entry");
+static_assert(sizeof(ws_datagram_min_max_resp_t) == 104, "min max resp");
+static_assert(sizeof(ws_sensor_sht1x_t) == 12, "sht1x");
+static_assert(sizeof(ws_sensor_bmp085_t) == 36, "bmp085");
+static_assert(sizeof(ws_sensor_bmp085_cal_t) == 28, "bmp085 cal");
+static_assert(sizeof(ws_sensor_bmp085_raw_t) == 12, "bmp085 raw");
+static_assert(offsetof(ws_datagram_header_t, data_len) == 2, "data_len");
+static_assert(offsetof(ws_sensor_bmp085_t, pressure) == 28, "bmp085 pressure");
+static_assert(offsetof(ws_sensor_bmp085_raw_t, pressure) == 8, "bmp085 raw pressure");
+static_assert(offsetof(ws_datagram_time_date_resp_t, crc) == 14, "time date crc");
+static_assert(sizeof(ws_datagram_format_t) == 8, "format");
+
+namespace ws {
+
+namespace {
+
+/* USART_SYNC_BYTES as they appear on the wire */
+const uint8_t sync_bytes[4] = {
+	USART_SYNC_BYTES & 0xFF, (USART_SYNC_BYTES >> 8) & 0xFF,
+	(USART_SYNC_BYTES >> 16) & 0xFF, (USART_SYNC_BYTES >> 24) & 0xFF
+};
+const size_t sync_len = sizeof(sync_bytes);
+const size_t header_len = sizeof(ws_datagram_header_t);
+
+/* Slicing-by-8 tables for WS_CRC_POLY. t[0] is the usual byte table,  */
+/* t[k][i] is the CRC of byte i followed by k zero bytes, so 8 bytes can */
+/* be folded into the CRC with 8 independent lookups.                   */
+struct crc_tables {
+	uint16_t t[8][256];
+	crc_tables() {
+		for(unsigned i = 0; i < 256; i++) {
+			uint16_t c = i;
+			for(int b = 0; b < 8; b++) {
+				c = (c & 1) ? (c >> 1) ^ WS_CRC_POLY : c >> 1;
+			}
+			t[0][i] = c;
+		}
+		for(unsigned i = 0; i < 256; i++) {
+			for(int k = 1; k < 8; k++) {
+				t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+			}
+		}
+	}
+};
+const crc_tables crc_tab;
+
+} /* namespace */
+
+uint16_t crc16(const uint8_t *p, size_t len, uint16_t crc) {
+	const uint16_t (*t)[256] = crc_tab.t;
+
+	while(len >= 8) {
+		crc ^= load_le16(p);
+		crc = t[7][crc & 0xFF] ^ t[6][crc >> 8] ^
+		      t[5][p[2]] ^ t[4][p[3]] ^ t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+		p += 8;
+		len -= 8;
+	}
+	while(len--) {
+		crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+	}
+	return crc;
+}
+
+/* Same encoding as ws_frame_put() in the firmware */
+size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out) {
+	const uint8_t *end = in + len;
+	uint8_t *o = out;
+	uint8_t *code_p;
+	uint8_t code;
+
+	for(;;) {
+		code_p = o++;
+		code = 1;
+		while(in < end && *in != 0 && code < 0xFF) {
+			*o++ = *in++;
+			code++;
+		}
+		*code_p = code;
+		if(in >= end) {
+			break;
+		}
+		if(code != 0xFF) {
+			in++; /* The zero is implied by the code */
+		}
+	}
+	return o - out;
+}
+
+size_t cobs_decode(const uint8_t *in, size_t len, uint8_t *out) {
+	const uint8_t *end = in + len;
+	uint8_t *o = out;
+	uint8_t code;
+
+	while(in < end) {
+		code = *in++;
+		if(code == WS_COBS_DELIMITER || size_t(end - in) < size_t(code - 1)) {
+			return SIZE_MAX;
+		}
+		/* Runs are short (padding makes zeros common), a loop beats memmove() */
+		for(const uint8_t *run_end = in + code - 1; in < run_end; ) {
+			*o++ = *in++;
+		}
+		if(code != 0xFF && in < end) {
+			*o++ = 0;
+		}
+	}
+	return o - out;
+}
+
+size_t subpacket_record_size(uint16_t packet_id) {
+	switch(packet_id) {
+	case WS_SENSOR_NFT_NULL:
+	case WS_SENSOR_NTF_MODE_ID:
+		return 0;
+	case WS_SENSOR_NTF_SHT1X:
+		return sizeof(ws_sensor_sht1x_t);
+	case WS_SENSOR_NTF_BMP085:
+		return sizeof(ws_sensor_bmp085_t);
+	case WS_SENSOR_NTF_BMP085_CAL:
+		return sizeof(ws_sensor_bmp085_cal_t);
+	case WS_SENSOR_NTF_BMP085_RAW:
+		return sizeof(ws_sensor_bmp085_raw_t);
+	default:
+		return SIZE_MAX;
+	}
+}
+
+void subpacket_iterator::load() {
+	size_t rlen;
+
+	if(p_ == nullptr || size_t(end_ - p_) < sizeof(ws_ntf_subheader_t)) {
+		p_ = nullptr;
+		return;
+	}
+	cur_.packet_id = load_le16(p_ + WS_OFF(ws_ntf_subheader_t, packet_id));
+	cur_.data = load_le16(p_ + WS_OFF(ws_ntf_subheader_t, data));
+	rlen = subpacket_record_size(cur_.packet_id);
+	if(cur_.packet_id == WS_SENSOR_NFT_NULL || rlen == SIZE_MAX ||
+	   rlen > size_t(end_ - p_) - sizeof(ws_ntf_subheader_t)) {
+		p_ = nullptr;
+		return;
+	}
+	cur_.record = rlen ? p_ + sizeof(ws_ntf_subheader_t) : nullptr;
+	cur_.record_len = rlen;
+	next_ = p_ + sizeof(ws_ntf_subheader_t) + rlen;
+}
+
+bool subpacket_range::complete() const {
+	const uint8_t *p = p_;
+	size_t rlen;
+	uint16_t id;
+
+	while(size_t(end_ - p) >= sizeof(ws_ntf_subheader_t)) {
+		id = load_le16(p);
+		if(id == WS_SENSOR_NFT_NULL) {
+			return size_t(end_ - p) == sizeof(ws_ntf_subheader_t);
+		}
+		rlen = subpacket_record_size(id);
+		if(rlen == SIZE_MAX) {
+			return false;
+		}
+		p += sizeof(ws_ntf_subheader_t) + rlen;
+	}
+	return false;
+}
+
+scanner::scanner(size_t max_data_len) : max_data_len_(max_data_len), stats_() {
+}
+
+bool scanner::next(const uint8_t *&pos, const uint8_t *end, datagram &out) {
+	const uint8_t *p = pos;
+
+	for(;;) {
+		/* Find the first sync byte, then check the rest */
+		const uint8_t *s = static_cast<const uint8_t *>(memchr(p, sync_bytes[0], end - p));
+		if(s == nullptr) {
+			stats_.skipped += end - p;
+			stats_.bytes += end - p;
+			pos = end;
+			return false;
+		}
+		stats_.skipped += s - p;
+		stats_.bytes += s - p;
+		p = s;
+
+		if(size_t(end - p) < sync_len + header_len) {
+			/* Maybe a sync, wait for more */
+			pos = p;
+			return false;
+		}
+		if(memcmp(p, sync_bytes, sync_len) != 0) {
+			stats_.skipped++;
+			stats_.bytes++;
+			p++;
+			continue;
+		}
+
+		const uint8_t *dg = p + sync_len;
+		size_t data_len = load_le16(dg + WS_OFF(ws_datagram_header_t, data_len));
+		if(data_len < 2 || data_len > max_data_len_) {
+			/* Sync bytes in the data or a damaged header, search again from the next byte */
+			stats_.length_errors++;
+			stats_.skipped++;
+			stats_.bytes++;
+			p++;
+			continue;
+		}
+
+		size_t total = sync_len + header_len + data_len;
+		if(size_t(end - p) < total) {
+			pos = p;
+			return false;
+		}
+
+		size_t len = header_len + data_len;
+		if(crc16(dg, len - 2) != load_le16(dg + len - 2)) {
+			stats_.crc_errors++;
+			stats_.skipped++;
+			stats_.bytes++;
+			p++;
+			continue;
+		}
+
+		stats_.datagrams++;
+		stats_.bytes += total;
+		out = datagram(dg, len);
+		pos = p + total;
+		return true;
+	}
+}
+
+cobs_scanner::cobs_scanner(size_t max_data_len)
+	: max_frame_len_(cobs_max_len(header_len + max_data_len)), stats_() {
+}
+
+bool cobs_scanner::next(uint8_t *&pos, uint8_t *end, datagram &out) {
+	uint8_t *p = pos;
+
+	for(;;) {
+		uint8_t *z = static_cast<uint8_t *>(memchr(p, WS_COBS_DELIMITER, end - p));
+		if(z == nullptr) {
+			if(size_t(end - p) > max_frame_len_) {
+				/* Too long for a datagram, cannot be one */
+				stats_.skipped += end - p;
+				stats_.bytes += end - p;
+				p = end;
+			}
+			pos = p;
+			return false;
+		}
+
+		uint8_t *frame = p;
+		size_t flen = z - p;
+		p = z + 1;
+		stats_.bytes += flen + 1;
+		if(flen == 0) {
+			continue;
+		}
+
+		size_t len = flen <= max_frame_len_ ? cobs_decode(frame, flen, frame) : SIZE_MAX;
+		if(len == SIZE_MAX) {
+			stats_.frame_errors++;
+			stats_.skipped += flen + 1;
+			continue;
+		}
+		if(len < header_len + 2 ||
+		   len != header_len + load_le16(frame + WS_OFF(ws_datagram_header_t, data_len))) {
+			stats_.length_errors++;
+			stats_.skipped += flen + 1;
+			continue;
+		}
+		if(crc16(frame, len - 2) != load_le16(frame + len - 2)) {
+			stats_.crc_errors++;
+			stats_.skipped += flen + 1;
+			continue;
+		}
+
+		stats_.datagrams++;
+		out = datagram(frame, len);
+		pos = p;
+		return true;
+	}
+}
+
+stream_decoder::stream_decoder(size_t capacity, size_t max_data_len, framing f)
+	: buf_(capacity < 2 * (sync_len + header_len + max_data_len) + 16 ?
+	       2 * (sync_len + header_len + max_data_len) + 16 : capacity),
+	  begin_(0), end_(0), framing_(f), scan_(max_data_len), cobs_(max_data_len) {
+}
+
+uint8_t *stream_decoder::write_ptr() {
+	/* Move the unconsumed tail to the front once the free space runs low. */
+	/* After next() has returned false the tail is at most one maximum size */
+	/* datagram and the buffer holds two, so there is always room to read.  */
+	if(begin_ == end_) {
+		begin_ = end_ = 0;
+	} else if(write_space() < buf_.size() / 2) {
+		memmove(buf_.data(), buf_.data() + begin_, end_ - begin_);
+		end_ -= begin_;
+		begin_ = 0;
+	}
+	return buf_.data() + end_;
+}
+
+ssize_t stream_decoder::read_from(int fd) {
+	uint8_t *p = write_ptr();
+	ssize_t n = read(fd, p, write_space());
+
+	if(n > 0) {
+		commit(n);
+	}
+	return n;
+}
+
+size_t stream_decoder::feed(const uint8_t *p, size_t n) {
+	uint8_t *w = write_ptr();
+
+	if(n > write_space()) {
+		n = write_space();
+	}
+	memcpy(w, p, n);
+	commit(n);
+	return n;
+}
+
+bool stream_decoder::next(datagram &out) {
+	uint8_t *base = buf_.data();
+	bool found;
+
+	if(framing_ == framing::cobs) {
+		uint8_t *pos = base + begin_;
+		found = cobs_.next(pos, base + end_, out);
+		begin_ = pos - base;
+	} else {
+		const uint8_t *pos = base + begin_;
+		found = scan_.next(pos, base + end_, out);
+		begin_ = pos - base;
+	}
+	return found;
+}
+
+namespace {
+
+/* Reads a varint of at most 5 bytes. Returns false if it does not end before end. */
+bool read_varint(const uint8_t *&p, const uint8_t *end, uint32_t &v) {
+	v = 0;
+	for(int shift = 0; shift < 35 && p < end; shift += 7) {
+		uint8_t b = *p++;
+		v |= uint32_t(b & 0x7F) << shift;
+		if(!(b & 0x80)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+uint32_t unzigzag(uint32_t z) {
+	return (z >> 1) ^ (0 - (z & 1));
+}
+
+} /* namespace */
+
+compact_decoder::track &compact_decoder::find(uint16_t node_id, uint8_t kind, uint8_t sensor_id) {
+	for(track &t : tracks_) {
+		if(t.node_id == node_id && t.kind == kind && t.sensor_id == sensor_id) {
+			return t;
+		}
+	}
+	tracks_.push_back(track{node_id, kind, sensor_id, false, {0, 0}, {0, 0}});
+	return tracks_.back();
+}
+
+void compact_decoder::invalidate(uint16_t node_id) {
+	for(track &t : tracks_) {
+		if(t.node_id == node_id) {
+			t.valid = false;
+		}
+	}
+}
+
+/* Reads one record after its type byte. The values of DELTA records are restored */
+/* from the track, which is updated. Returns false if the record is malformed.     */
+bool compact_decoder::parse_record(uint8_t type, uint16_t node_id, const uint8_t *&p, const uint8_t *end,
+				   compact_record &r) {
+	if(p >= end) {
+		return false;
+	}
+	r.sensor_id = *p++;
+
+	switch(type) {
+	case WS_CNTF_SHT1X_ABS:
+	case WS_CNTF_BMP085_RAW_ABS: {
+		size_t key_len = type == WS_CNTF_SHT1X_ABS ? 1 : 2;
+		if(size_t(end - p) < key_len) {
+			return false;
+		}
+		memcpy(r.key, p, key_len);
+		p += key_len;
+		if(!read_varint(p, end, r.value[0]) || !read_varint(p, end, r.value[1])) {
+			return false;
+		}
+		r.kind = type;
+		r.absolute = true;
+		track &t = find(node_id, type, r.sensor_id);
+		t.valid = true;
+		memcpy(t.key, r.key, sizeof(t.key));
+		memcpy(t.value, r.value, sizeof(t.value));
+		return true;
+	}
+	case WS_CNTF_SHT1X_DELTA:
+	case WS_CNTF_BMP085_RAW_DELTA: {
+		uint32_t d0, d1;
+		if(!read_varint(p, end, d0) || !read_varint(p, end, d1)) {
+			return false;
+		}
+		r.kind = type - 1;
+		track &t = find(node_id, r.kind, r.sensor_id);
+		if(!t.valid) {
+			r.kind = 0;  /* Stale, skipped by the caller */
+			return true;
+		}
+		t.value[0] += unzigzag(d0);
+		t.value[1] += unzigzag(d1);
+		memcpy(r.key, t.key, sizeof(r.key));
+		memcpy(r.value, t.value, sizeof(r.value));
+		return true;
+	}
+	case WS_CNTF_BMP085_CAL: {
+		const size_t len = 1 + 11 * 2;
+		if(size_t(end - p) < len) {
+			return false;
+		}
+		r.kind = type;
+		r.absolute = true;
+		r.key[0] = p[0];
+		r.cal.ac1 = int16_t(load_le16(p + 1));
+		r.cal.ac2 = int16_t(load_le16(p + 3));
+		r.cal.ac3 = int16_t(load_le16(p + 5));
+		r.cal.ac4 = load_le16(p + 7);
+		r.cal.ac5 = load_le16(p + 9);
+		r.cal.ac6 = load_le16(p + 11);
+		r.cal.b1 = int16_t(load_le16(p + 13));
+		r.cal.b2 = int16_t(load_le16(p + 15));
+		r.cal.mb = int16_t(load_le16(p + 17));
+		r.cal.mc = int16_t(load_le16(p + 19));
+		r.cal.md = int16_t(load_le16(p + 21));
+		p += len;
+		return true;
+	}
+	default:
+		return false;
+	}
+}
+
+bool compact_decoder::decode(const datagram &d, uint16_t &node_id, std::vector<compact_record> &out) {
+	const uint8_t *p = d.data() + sizeof(ws_datagram_header_t);
+	const uint8_t *end = d.data() + d.size() - 2;
+	bool batch = d.type() == WS_DG_TYPE_SENSOR_DATA_BNTF;
+	node_state *ns = nullptr;
+	int32_t age = 0;
+	uint32_t interval = 0;
+	uint8_t sample = 0;
+	uint32_t v;
+
+	out.clear();
+	if((d.type() != WS_DG_TYPE_SENSOR_DATA_CNTF && !batch) || p >= end ||
+	   *p++ != (batch ? WS_FORMAT_BATCH_V1 : WS_FORMAT_COMPACT_V1) ||
+	   !read_varint(p, end, v) || v > 0xFFFF || (batch && end - p < 2)) {
+		stats_.errors++;
+		return false;
+	}
+	node_id = uint16_t(v);
+	if(batch) {
+		age = load_le16(p);
+		p += 2;
+	}
+
+	/* Deltas are only usable if the previous CNTF/BNTF datagram of the node arrived */
+	for(node_state &n : nodes_) {
+		if(n.node_id == node_id) {
+			ns = &n;
+		}
+	}
+	if(!ns) {
+		nodes_.push_back(node_state{node_id, uint8_t(d.msg_id() - 1)});
+		ns = &nodes_.back();
+	}
+	if(uint8_t(ns->msg_id + 1) != d.msg_id()) {
+		stats_.gaps++;
+		invalidate(node_id);
+	}
+	ns->msg_id = d.msg_id();
+
+	while(p < end) {
+		uint8_t type = *p++;
+		compact_record r = {};
+		bool ok = true;
+
+		if(batch && (type == WS_CNTF_TIME || type == WS_CNTF_TIME_SAME)) {
+			/* The next sample of the batch */
+			if(type == WS_CNTF_TIME) {
+				ok = read_varint(p, end, v);
+				interval += unzigzag(v);
+			}
+			age -= int32_t(uint16_t(interval));
+			sample++;
+		} else {
+			r.sample = sample;
+			r.age = age;
+			ok = parse_record(type, node_id, p, end, r);
+			if(ok && !r.kind) {
+				stats_.stale++;
+			} else if(ok) {
+				out.push_back(r);
+			}
+		}
+		if(!ok) {
+			stats_.errors++;
+			invalidate(node_id);
+			out.clear();
+			return false;
+		}
+	}
+	samples_ = sample + 1u;
+	stats_.datagrams++;
+	stats_.records += out.size();
+	return true;
+}
+
+} /* namespace ws */
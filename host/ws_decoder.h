@@ -0,0 +1,391 @@
+/*
+ * Host side decoder for the weather station serial protocol (protocol.h)
+ *
+ * Bytes from a file, pipe or tty go into a stream_decoder. It finds
+ * USART_SYNC_BYTES (or the WS_COBS_DELIMITER with COBS framing), checks the
+ * length and CRC of the datagram and hands out views that point straight
+ * into its buffer. COBS frames are decoded in place. Nothing is copied or
+ * allocated per datagram.
+ *
+ * Wire format (see the top of protocol.h): all fields are little endian and
+ * every struct keeps 4 byte alignment with explicit padding, so a field is
+ * at offsetof(struct, field) on both the AVR and the host. The views read
+ * fields with byte loads, so neither host endianness nor the alignment of
+ * the datagram inside the buffer matters.
+ *
+ * Compact notifications (WS_FORMAT_COMPACT_V1) carry deltas, so they are not
+ * viewed in place: compact_decoder keeps the previous values per node and
+ * sensor and restores the records.
+ */
+
+#ifndef _WS_DECODER_H_
+#define _WS_DECODER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <sys/types.h>
+
+#include "protocol.h"
+
+namespace ws {
+
+/* Little endian loads from possibly unaligned memory */
+inline uint16_t load_le16(const uint8_t *p) {
+	return uint16_t(p[0] | p[1] << 8);
+}
+
+inline uint32_t load_le32(const uint8_t *p) {
+	return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+/* Datagram CRC (WS_CRC_POLY/WS_CRC_INIT in protocol.h), slicing-by-8.      */
+/* Bit-identical to ws_crc_block() in the firmware (checked by ws_crc_bench). */
+uint16_t crc16(const uint8_t *p, size_t len, uint16_t crc = WS_CRC_INIT);
+
+/* COBS encoding (see WS_COBS_DELIMITER in protocol.h). The delimiter is  */
+/* not part of the encoding. out needs room for cobs_max_len(len) bytes.  */
+/* cobs_decode() may decode in place (out == in) and returns SIZE_MAX if */
+/* the input is not valid COBS.                                          */
+inline size_t cobs_max_len(size_t len) { return len + len / 254 + 1; }
+size_t cobs_encode(const uint8_t *in, size_t len, uint8_t *out);
+size_t cobs_decode(const uint8_t *in, size_t len, uint8_t *out);
+
+/* Framing of datagrams on the link */
+enum class framing {
+	sync, /* USART_SYNC_BYTES + datagram */
+	cobs  /* COBS(datagram) + WS_COBS_DELIMITER */
+};
+
+/* Size of the record after a subheader, or 0 for subheaders without one. */
+/* Returns SIZE_MAX for packet ids this decoder does not know.            */
+size_t subpacket_record_size(uint16_t packet_id);
+
+/* Base for views into a protocol.h struct T */
+template <typename T>
+class record_view {
+public:
+	static constexpr size_t size = sizeof(T);
+
+	record_view() : p_(nullptr) {}
+	explicit record_view(const uint8_t *p) : p_(p) {}
+	const uint8_t *data() const { return p_; }
+
+protected:
+	uint8_t u8(size_t off) const { return p_[off]; }
+	uint16_t u16(size_t off) const { return load_le16(p_ + off); }
+	int16_t s16(size_t off) const { return int16_t(load_le16(p_ + off)); }
+	uint32_t u32(size_t off) const { return load_le32(p_ + off); }
+
+	const uint8_t *p_;
+};
+
+#define WS_OFF(T, m) offsetof(T, m)
+
+class sht1x_view : public record_view<ws_sensor_sht1x_t> {
+public:
+	using record_view::record_view;
+	uint16_t sensor_id() const { return u16(WS_OFF(ws_sensor_sht1x_t, header.sensor_id)); }
+	uint16_t temperature() const { return u16(WS_OFF(ws_sensor_sht1x_t, temperature)); }
+	uint16_t humidity() const { return u16(WS_OFF(ws_sensor_sht1x_t, humidity)); }
+	uint8_t resolution_setting() const { return u8(WS_OFF(ws_sensor_sht1x_t, resolution_setting)); }
+};
+
+/* BMP085 calibration words, in register order */
+struct bmp085_calibration {
+	int16_t ac1, ac2, ac3;
+	uint16_t ac4, ac5, ac6;
+	int16_t b1, b2, mb, mc, md;
+};
+
+/* ac1..md have the same layout in ws_sensor_bmp085_t and ws_sensor_bmp085_cal_t */
+template <typename T>
+class bmp085_cal_fields : public record_view<T> {
+public:
+	using record_view<T>::record_view;
+	uint16_t sensor_id() const { return this->u16(WS_OFF(T, header.sensor_id)); }
+	bmp085_calibration calibration() const {
+		bmp085_calibration c;
+		c.ac1 = this->s16(WS_OFF(T, ac1));
+		c.ac2 = this->s16(WS_OFF(T, ac2));
+		c.ac3 = this->s16(WS_OFF(T, ac3));
+		c.ac4 = this->u16(WS_OFF(T, ac4));
+		c.ac5 = this->u16(WS_OFF(T, ac5));
+		c.ac6 = this->u16(WS_OFF(T, ac6));
+		c.b1 = this->s16(WS_OFF(T, b1));
+		c.b2 = this->s16(WS_OFF(T, b2));
+		c.mb = this->s16(WS_OFF(T, mb));
+		c.mc = this->s16(WS_OFF(T, mc));
+		c.md = this->s16(WS_OFF(T, md));
+		return c;
+	}
+};
+
+class bmp085_view : public bmp085_cal_fields<ws_sensor_bmp085_t> {
+public:
+	using bmp085_cal_fields::bmp085_cal_fields;
+	uint16_t temperature() const { return u16(WS_OFF(ws_sensor_bmp085_t, temperature)); }
+	uint32_t pressure() const { return u32(WS_OFF(ws_sensor_bmp085_t, pressure)); }
+	uint8_t oversampling() const { return u8(WS_OFF(ws_sensor_bmp085_t, oversampling)); }
+};
+
+class bmp085_cal_view : public bmp085_cal_fields<ws_sensor_bmp085_cal_t> {
+public:
+	using bmp085_cal_fields::bmp085_cal_fields;
+	uint8_t cal_tag() const { return u8(WS_OFF(ws_sensor_bmp085_cal_t, cal_tag)); }
+};
+
+class bmp085_raw_view : public record_view<ws_sensor_bmp085_raw_t> {
+public:
+	using record_view::record_view;
+	uint16_t sensor_id() const { return u16(WS_OFF(ws_sensor_bmp085_raw_t, header.sensor_id)); }
+	uint16_t temperature() const { return u16(WS_OFF(ws_sensor_bmp085_raw_t, temperature)); }
+	uint8_t oversampling() const { return u8(WS_OFF(ws_sensor_bmp085_raw_t, oversampling)); }
+	uint8_t cal_tag() const { return u8(WS_OFF(ws_sensor_bmp085_raw_t, cal_tag)); }
+	uint32_t pressure() const { return u32(WS_OFF(ws_sensor_bmp085_raw_t, pressure)); }
+};
+
+class time_date_view : public record_view<ws_datagram_time_date_resp_t> {
+public:
+	using record_view::record_view;
+	uint16_t year() const { return u16(WS_OFF(ws_datagram_time_date_resp_t, year)); }
+	uint8_t month() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, month)); }
+	uint8_t day() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, day)); }
+	uint8_t weekday() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, weekday)); }
+	uint8_t hours() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, hours)); }
+	uint8_t minutes() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, minutes)); }
+	uint8_t seconds() const { return u8(WS_OFF(ws_datagram_time_date_resp_t, seconds)); }
+	uint16_t milliseconds() const { return u16(WS_OFF(ws_datagram_time_date_resp_t, milliseconds)); }
+};
+
+class min_max_view : public record_view<min_max_temp_t> {
+public:
+	using record_view::record_view;
+	uint16_t temp() const { return u16(WS_OFF(min_max_temp_t, temp)); }
+	uint16_t year() const { return u16(WS_OFF(min_max_temp_t, year)); }
+	uint8_t month() const { return u8(WS_OFF(min_max_temp_t, month)); }
+	uint8_t day() const { return u8(WS_OFF(min_max_temp_t, day)); }
+	uint8_t weekday() const { return u8(WS_OFF(min_max_temp_t, weekday)); }
+	uint8_t hours() const { return u8(WS_OFF(min_max_temp_t, hours)); }
+	uint8_t minutes() const { return u8(WS_OFF(min_max_temp_t, minutes)); }
+	bool valid() const { return u8(WS_OFF(min_max_temp_t, valid)) != 0; }
+};
+
+/* One subheader of a sensor data notification and the record after it */
+struct subpacket {
+	uint16_t packet_id;    /* WS_SENSOR_NTF_* */
+	uint16_t data;         /* Node id for WS_SENSOR_NTF_MODE_ID, crc for WS_SENSOR_NFT_NULL */
+	const uint8_t *record; /* ws_sensor_*_t, nullptr if the subheader has none */
+	size_t record_len;
+};
+
+/* Walks the subheaders of a sensor data notification. Stops at the */
+/* WS_SENSOR_NFT_NULL subheader, an unknown packet id or the end.   */
+class subpacket_iterator {
+public:
+	subpacket_iterator() : p_(nullptr), end_(nullptr), next_(nullptr) {}
+	subpacket_iterator(const uint8_t *p, const uint8_t *end) : p_(p), end_(end) { load(); }
+
+	const subpacket &operator*() const { return cur_; }
+	const subpacket *operator->() const { return &cur_; }
+	subpacket_iterator &operator++() { p_ = next_; load(); return *this; }
+	bool operator!=(const subpacket_iterator &o) const { return p_ != o.p_; }
+	bool operator==(const subpacket_iterator &o) const { return p_ == o.p_; }
+
+private:
+	void load();
+
+	const uint8_t *p_;
+	const uint8_t *end_;
+	const uint8_t *next_;
+	subpacket cur_;
+};
+
+class subpacket_range {
+public:
+	subpacket_range(const uint8_t *p, const uint8_t *end) : p_(p), end_(end) {}
+	subpacket_iterator begin() const { return subpacket_iterator(p_, end_); }
+	subpacket_iterator end() const { return subpacket_iterator(); }
+	/* True if the chain is well formed and ends with the NULL subheader */
+	bool complete() const;
+
+private:
+	const uint8_t *p_;
+	const uint8_t *end_;
+};
+
+/* A datagram with a valid CRC: header, data and the ending crc (no sync bytes) */
+class datagram {
+public:
+	datagram() : p_(nullptr), len_(0) {}
+	datagram(const uint8_t *p, size_t len) : p_(p), len_(len) {}
+
+	const uint8_t *data() const { return p_; }
+	size_t size() const { return len_; }
+
+	uint8_t type() const { return p_[WS_OFF(ws_datagram_header_t, datagram_type)]; }
+	uint8_t msg_id() const { return p_[WS_OFF(ws_datagram_header_t, msg_id)]; }
+	uint16_t data_len() const { return load_le16(p_ + WS_OFF(ws_datagram_header_t, data_len)); }
+	uint16_t crc() const { return load_le16(p_ + len_ - 2); }
+
+	/* Subpackets of a WS_DG_TYPE_SENSOR_DATA_NTF datagram */
+	subpacket_range subpackets() const {
+		return subpacket_range(p_ + sizeof(ws_datagram_header_t), p_ + len_);
+	}
+
+	/* Whole datagram as a fixed size struct view, e.g. time_date_view. */
+	/* Returns a null view if the datagram is shorter than the struct. */
+	template <typename V>
+	V as() const { return len_ >= V::size ? V(p_) : V(); }
+
+private:
+	const uint8_t *p_;
+	size_t len_;
+};
+
+/* A record of a compact sensor data notification with its values restored */
+struct compact_record {
+	uint8_t kind;            /* WS_CNTF_SHT1X_ABS, WS_CNTF_BMP085_RAW_ABS or WS_CNTF_BMP085_CAL */
+	uint8_t sensor_id;
+	uint8_t sample;          /* Sample of a batch (BNTF) the record belongs to, 0 otherwise */
+	int32_t age;             /* ms from taking the sample to queueing the batch, 0 for CNTF */
+	bool absolute;           /* Sent as an ABS record */
+	uint8_t key[2];          /* SHT1X: resolution_setting. BMP085_RAW: oversampling, cal_tag. */
+	                         /* BMP085_CAL: cal_tag.                                          */
+	uint32_t value[2];       /* SHT1X: temperature, humidity. BMP085_RAW: temperature, pressure. */
+	bmp085_calibration cal;  /* BMP085_CAL only */
+};
+
+struct compact_stats {
+	uint64_t datagrams;      /* CNTF and BNTF datagrams decoded */
+	uint64_t records;        /* Records restored */
+	uint64_t stale;          /* DELTA records skipped, no base after lost datagrams */
+	uint64_t gaps;           /* msg_id gaps (lost datagrams) */
+	uint64_t errors;         /* Unknown version or malformed datagram */
+};
+
+/* Restores WS_DG_TYPE_SENSOR_DATA_CNTF and _BNTF records. Feed it every */
+/* compact or batched datagram of the link in order.                     */
+class compact_decoder {
+public:
+	/* Decodes d into node_id and out (cleared first; reuse it to avoid */
+	/* allocations). Returns false for a datagram that is not a valid   */
+	/* CNTF or BNTF.                                                    */
+	bool decode(const datagram &d, uint16_t &node_id, std::vector<compact_record> &out);
+
+	/* Forget all previous values, e.g. after sending WS_DG_TYPE_FORMAT_REQ */
+	void reset() { nodes_.clear(); tracks_.clear(); }
+
+	/* Samples in the last datagram decoded (1 for CNTF) */
+	unsigned samples() const { return samples_; }
+
+	const compact_stats &stats() const { return stats_; }
+
+private:
+	struct node_state {
+		uint16_t node_id;
+		uint8_t msg_id;  /* Of the last CNTF/BNTF datagram */
+	};
+	struct track {
+		uint16_t node_id;
+		uint8_t kind;
+		uint8_t sensor_id;
+		bool valid;
+		uint8_t key[2];
+		uint32_t value[2];
+	};
+
+	track &find(uint16_t node_id, uint8_t kind, uint8_t sensor_id);
+	bool parse_record(uint8_t type, uint16_t node_id, const uint8_t *&p, const uint8_t *end,
+			  compact_record &r);
+	void invalidate(uint16_t node_id);
+
+	std::vector<node_state> nodes_;
+	std::vector<track> tracks_;
+	compact_stats stats_ = {};
+	unsigned samples_ = 0;
+};
+
+struct decoder_stats {
+	uint64_t bytes;         /* Bytes taken from the input */
+	uint64_t datagrams;     /* Datagrams with a valid CRC */
+	uint64_t crc_errors;    /* Sync + plausible header found but CRC did not match */
+	uint64_t length_errors; /* Sync found but data_len out of range (COBS: not matching the frame) */
+	uint64_t frame_errors;  /* COBS frame that does not decode */
+	uint64_t skipped;       /* Bytes outside valid datagrams */
+};
+
+/* Finds datagrams in a contiguous buffer, for example an mmap()ed capture. */
+class scanner {
+public:
+	/* Largest data_len accepted. Anything larger is taken as a false sync. */
+	static constexpr size_t default_max_data_len = 1024;
+
+	explicit scanner(size_t max_data_len = default_max_data_len);
+
+	/* Looks for the next datagram in [*pos, end). Returns true and advances */
+	/* *pos past it, or returns false when more input is needed. In that    */
+	/* case *pos is where the search has to continue.                        */
+	bool next(const uint8_t *&pos, const uint8_t *end, datagram &out);
+
+	const decoder_stats &stats() const { return stats_; }
+
+private:
+	size_t max_data_len_;
+	decoder_stats stats_;
+};
+
+/* Finds COBS framed datagrams in a buffer and decodes them in place. */
+class cobs_scanner {
+public:
+	explicit cobs_scanner(size_t max_data_len = scanner::default_max_data_len);
+
+	/* Same contract as scanner::next(), but the frames in [*pos, end) */
+	/* are overwritten by their decoded datagrams.                    */
+	bool next(uint8_t *&pos, uint8_t *end, datagram &out);
+
+	const decoder_stats &stats() const { return stats_; }
+
+private:
+	size_t max_frame_len_;
+	decoder_stats stats_;
+};
+
+/* Buffers a byte stream and finds datagrams in it. Call next() until it */
+/* returns false before adding more input. Datagram views stay valid     */
+/* until the next call of write_ptr(), read_from() or feed().            */
+class stream_decoder {
+public:
+	explicit stream_decoder(size_t capacity = 1 << 16,
+				size_t max_data_len = scanner::default_max_data_len,
+				framing f = framing::sync);
+
+	/* Zero copy input: read into write_ptr(), then commit() the bytes read */
+	uint8_t *write_ptr();
+	size_t write_space() const { return buf_.size() - end_; }
+	void commit(size_t n) { end_ += n; }
+
+	/* One read() from fd into the buffer. Returns what read() returned. */
+	ssize_t read_from(int fd);
+
+	/* Copying input for callers that already have the bytes elsewhere */
+	size_t feed(const uint8_t *p, size_t n);
+
+	bool next(datagram &out);
+
+	const decoder_stats &stats() const {
+		return framing_ == framing::cobs ? cobs_.stats() : scan_.stats();
+	}
+
+private:
+	std::vector<uint8_t> buf_;
+	size_t begin_;
+	size_t end_;
+	framing framing_;
+	scanner scan_;
+	cobs_scanner cobs_;
+};
+
+} /* namespace ws */
+
+#endif
@@ -0,0 +1,194 @@
+/*
+ * Prints the datagrams in a weather station byte stream, one per line
+ *
+ * Usage: ws_dump [-c] [file | fifo | tty]   (stdin if no file)
+ *
+ *   -c  COBS framing (firmware built with WS_FRAMING=WS_FRAMING_COBS)
+ *
+ * A tty is switched to raw mode at 9600 baud, the rate the firmware uses.
+ * Values of compact DELTA records are marked with '+', the samples of a batch
+ * start with their age.
+ */
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ws_decoder.h"
+
+static ws::compact_decoder compact;
+static std::vector<ws::compact_record> records;
+
+static void print_compact(const ws::datagram &d) {
+	uint16_t node;
+
+	if(!compact.decode(d, node, records)) {
+		printf(" (malformed)");
+		return;
+	}
+	printf(" node %u", node);
+	for(size_t i = 0; i < records.size(); i++) {
+		const ws::compact_record &r = records[i];
+		/* Batches: age of every sample */
+		if(d.type() == WS_DG_TYPE_SENSOR_DATA_BNTF && (i == 0 || records[i - 1].sample != r.sample)) {
+			printf(" | -%dms", (int)r.age);
+		}
+		switch(r.kind) {
+		case WS_CNTF_SHT1X_ABS:
+			printf(" sht1x[%u]%s t %u rh %u res %u", r.sensor_id, r.absolute ? "" : "+",
+			       r.value[0], r.value[1], r.key[0]);
+			break;
+		case WS_CNTF_BMP085_RAW_ABS:
+			printf(" bmp085_raw[%u]%s ut %u up %u oss %u tag %02x", r.sensor_id,
+			       r.absolute ? "" : "+", r.value[0], r.value[1], r.key[0], r.key[1]);
+			break;
+		case WS_CNTF_BMP085_CAL:
+			printf(" bmp085_cal[%u] tag %02x ac1 %d ac2 %d ac3 %d ac4 %u ac5 %u ac6 %u"
+			       " b1 %d b2 %d mb %d mc %d md %d", r.sensor_id, r.key[0],
+			       r.cal.ac1, r.cal.ac2, r.cal.ac3, r.cal.ac4, r.cal.ac5, r.cal.ac6,
+			       r.cal.b1, r.cal.b2, r.cal.mb, r.cal.mc, r.cal.md);
+			break;
+		}
+	}
+}
+
+static void print_datagram(const ws::datagram &d) {
+	printf("type %u msg %3u len %3u", d.type(), d.msg_id(), d.data_len());
+
+	switch(d.type()) {
+	case WS_DG_TYPE_SENSOR_DATA_NTF:
+		for(const ws::subpacket &s : d.subpackets()) {
+			switch(s.packet_id) {
+			case WS_SENSOR_NTF_MODE_ID:
+				printf(" node %u", s.data);
+				break;
+			case WS_SENSOR_NTF_SHT1X: {
+				ws::sht1x_view v(s.record);
+				printf(" sht1x[%u] t %u rh %u res %u", v.sensor_id(), v.temperature(),
+				       v.humidity(), v.resolution_setting());
+				break;
+			}
+			case WS_SENSOR_NTF_BMP085: {
+				ws::bmp085_view v(s.record);
+				printf(" bmp085[%u] ut %u up %u oss %u", v.sensor_id(), v.temperature(),
+				       v.pressure(), v.oversampling());
+				break;
+			}
+			case WS_SENSOR_NTF_BMP085_CAL: {
+				ws::bmp085_cal_view v(s.record);
+				ws::bmp085_calibration c = v.calibration();
+				printf(" bmp085_cal[%u] tag %02x ac1 %d ac2 %d ac3 %d ac4 %u ac5 %u ac6 %u"
+				       " b1 %d b2 %d mb %d mc %d md %d", v.sensor_id(), v.cal_tag(),
+				       c.ac1, c.ac2, c.ac3, c.ac4, c.ac5, c.ac6, c.b1, c.b2, c.mb, c.mc, c.md);
+				break;
+			}
+			case WS_SENSOR_NTF_BMP085_RAW: {
+				ws::bmp085_raw_view v(s.record);
+				printf(" bmp085_raw[%u] ut %u up %u oss %u tag %02x", v.sensor_id(),
+				       v.temperature(), v.pressure(), v.oversampling(), v.cal_tag());
+				break;
+			}
+			}
+		}
+		if(!d.subpackets().complete()) {
+			printf(" (unknown subpacket)");
+		}
+		break;
+	case WS_DG_TYPE_SENSOR_DATA_CNTF:
+	case WS_DG_TYPE_SENSOR_DATA_BNTF:
+		print_compact(d);
+		break;
+	case WS_DG_TYPE_FORMAT_RSP:
+		if(d.size() >= sizeof(ws_datagram_format_t)) {
+			printf(" format %u", d.data()[offsetof(ws_datagram_format_t, format)]);
+		}
+		break;
+	case WS_DG_TYPE_MIN_MAX_RSP:
+		if(d.size() >= sizeof(ws_datagram_min_max_resp_t)) {
+			static const char *const names[8] = {"max_out_24", "min_out_24", "max_in_24", "min_in_24",
+							     "max_out_12", "min_out_12", "max_in_12", "min_in_12"};
+			for(int i = 0; i < 8; i++) {
+				ws::min_max_view v(d.data() + offsetof(ws_datagram_min_max_resp_t, minmax_temp) +
+						   i * sizeof(min_max_temp_t));
+				if(v.valid()) {
+					printf(" %s %.1f@%04u-%02u-%02u %02u:%02u", names[i], int16_t(v.temp()) / 10.0,
+					       v.year(), v.month(), v.day(), v.hours(), v.minutes());
+				}
+			}
+		}
+		break;
+	case WS_DG_TYPE_TIME_DATE_RSP: {
+		ws::time_date_view v = d.as<ws::time_date_view>();
+		if(v.data()) {
+			printf(" %04u-%02u-%02u %02u:%02u:%02u.%03u", v.year(), v.month(), v.day(),
+			       v.hours(), v.minutes(), v.seconds(), v.milliseconds());
+		}
+		break;
+	}
+	}
+	printf("\n");
+}
+
+static void set_raw_tty(int fd) {
+	struct termios tio;
+
+	if(tcgetattr(fd, &tio) != 0) {
+		return;
+	}
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, B9600);
+	cfsetospeed(&tio, B9600);
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	tcsetattr(fd, TCSANOW, &tio);
+}
+
+int main(int argc, char **argv) {
+	int fd = STDIN_FILENO;
+	ws::framing f = ws::framing::sync;
+	ws::datagram d;
+	ssize_t n;
+	int arg = 1;
+
+	if(arg < argc && strcmp(argv[arg], "-c") == 0) {
+		f = ws::framing::cobs;
+		arg++;
+	}
+	if(arg < argc) {
+		fd = open(argv[arg], O_RDONLY | O_NOCTTY);
+		if(fd < 0) {
+			fprintf(stderr, "%s: %s\n", argv[arg], strerror(errno));
+			return 1;
+		}
+	}
+
+	ws::stream_decoder dec(1 << 16, ws::scanner::default_max_data_len, f);
+	if(isatty(fd)) {
+		set_raw_tty(fd);
+	}
+
+	while((n = dec.read_from(fd)) != 0) {
+		if(n < 0) {
+			if(errno == EINTR) {
+				continue;
+			}
+			perror("read");
+			return 1;
+		}
+		while(dec.next(d)) {
+			print_datagram(d);
+		}
+		fflush(stdout);
+	}
+
+	const ws::decoder_stats &st = dec.stats();
+	fprintf(stderr, "%llu datagrams, %llu crc errors, %llu length errors, %llu frame errors, %llu bytes skipped\n",
+		(unsigned long long)st.datagrams, (unsigned long long)st.crc_errors,
+		(unsigned long long)st.length_errors, (unsigned long long)st.frame_errors,
+		(unsigned long long)st.skipped);
+	return 0;
+}
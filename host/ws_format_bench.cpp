@@ -0,0 +1,263 @@
+/*
+ * Bytes per sample of the fixed, compact and batched notification formats
+ *
+ * Runs the firmware notification code (ws_ntf.c, ws_frame.c, ws_crc.c built
+ * for the host) over a synthetic series of BMP085 and SHT1x samples, one
+ * per second the way bmp085_task() sends them, and captures what would go
+ * out of the UART. The capture is decoded with stream_decoder and
+ * compact_decoder and every value is compared with the one sent. Runs
+ * that lose 1 in 50 datagrams check that DELTA records after a gap are
+ * skipped, never restored wrong. Exits with 1 on any mismatch.
+ *
+ * Batches are also sent when the next sample does not fit in WS_NTF_MAX_LEN;
+ * see FW_CPPFLAGS in the Makefile to try other sizes.
+ *
+ * Usage: ws_format_bench [samples]
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ws_decoder.h"
+
+extern "C" {
+#include "timebase.h"
+#include "uart.h"
+#include "ws_ntf.h"
+}
+
+namespace {
+
+std::vector<uint8_t> wire;
+uint16_t now_ms;
+
+struct sample {
+	uint16_t ut;
+	uint32_t up;
+	uint16_t t;
+	uint16_t rh;
+};
+
+/* Slow drift plus a few counts of noise, roughly what the sensors give indoors */
+/* (BMP085 at oversampling 3, SHT1x at 14/12 bits).                             */
+std::vector<sample> make_samples(size_t n) {
+	std::vector<sample> s(n);
+	uint32_t rnd = 2011;
+	int32_t ut = 27898, up = 330000, t = 6470, rh = 1400;
+
+	for(size_t i = 0; i < n; i++) {
+		rnd = rnd * 1103515245 + 12345;
+		ut += int32_t(rnd >> 29) - 3;
+		up += int32_t(rnd >> 27 & 31) - 16;
+		t += int32_t(rnd >> 14 & 3) - 1;
+		rh += int32_t(rnd >> 10 & 7) - 3;
+		s[i] = sample{uint16_t(ut), uint32_t(up), uint16_t(t), uint16_t(rh)};
+	}
+	return s;
+}
+
+const ws_sensor_bmp085_cal_t cal = {{0, 0, 0}, 408, -72, -14383, 32741, 32757, 23153, 6190, 4, -32767,
+				    -8711, 2868, 0x5A, 0};
+
+/* Sends the samples like bmp085_task(): calibration with the first one, one */
+/* sample per second with the odd millisecond of jitter.                      */
+void send(const std::vector<sample> &samples, bool sht1x) {
+	for(size_t i = 0; i < samples.size(); i++) {
+		ws_sensor_bmp085_raw_t raw = {};
+		ws_sensor_sht1x_t sht = {};
+
+		now_ms += 1000 + (i % 7 == 3) - (i % 7 == 4);
+		ws_ntf_poll();
+
+		raw.temperature = samples[i].ut;
+		raw.pressure = samples[i].up;
+		raw.oversampling = 3;
+		raw.cal_tag = cal.cal_tag;
+		sht.temperature = samples[i].t;
+		sht.humidity = samples[i].rh;
+
+		ws_ntf_begin(WS_NODE_ID_MAIN_UNIT);
+		if(i == 0) {
+			ws_ntf_add(WS_SENSOR_NTF_BMP085_CAL, &cal, sizeof(cal));
+		}
+		ws_ntf_add(WS_SENSOR_NTF_BMP085_RAW, &raw, sizeof(raw));
+		if(sht1x) {
+			ws_ntf_add(WS_SENSOR_NTF_SHT1X, &sht, sizeof(sht));
+		}
+		if(ws_ntf_send() != WS_NTF_OK) {
+			fprintf(stderr, "sample %zu not sent\n", i);
+			exit(1);
+		}
+	}
+	ws_ntf_flush();
+}
+
+struct result {
+	size_t datagrams;
+	size_t records;    /* Measurement records decoded with the right values */
+	size_t wrong;      /* Measurement records decoded with wrong values */
+	size_t stale;      /* Compact DELTA records skipped */
+};
+
+void check_value(result &r, bool ok) {
+	if(ok) {
+		r.records++;
+	} else {
+		r.wrong++;
+	}
+}
+
+/* Decodes the capture. Every lose_every:th datagram (if non-zero) is thrown away. */
+/* ref sees all datagrams and tells how many samples the lost ones had.          */
+result check(const std::vector<sample> &samples, size_t lose_every) {
+	ws::stream_decoder dec;
+	ws::compact_decoder compact, ref;
+	std::vector<ws::compact_record> records;
+	ws::datagram d;
+	result r = {};
+	size_t base = 0;
+	uint16_t node;
+
+	for(size_t off = 0; off < wire.size(); ) {
+		off += dec.feed(wire.data() + off, wire.size() - off);
+		for(; dec.next(d); r.datagrams++) {
+			bool lost = lose_every && r.datagrams % lose_every == lose_every / 2;
+			unsigned count = 1;
+
+			if(d.type() == WS_DG_TYPE_SENSOR_DATA_NTF) {
+				for(const ws::subpacket &s : d.subpackets()) {
+					if(s.packet_id == WS_SENSOR_NTF_BMP085_RAW && !lost) {
+						ws::bmp085_raw_view b(s.record);
+						check_value(r, b.temperature() == samples[base].ut &&
+							    b.pressure() == samples[base].up);
+					} else if(s.packet_id == WS_SENSOR_NTF_SHT1X && !lost) {
+						ws::sht1x_view h(s.record);
+						check_value(r, h.temperature() == samples[base].t &&
+							    h.humidity() == samples[base].rh);
+					}
+				}
+			} else {
+				ref.decode(d, node, records);
+				count = ref.samples();
+				if(!lost && compact.decode(d, node, records)) {
+					for(const ws::compact_record &c : records) {
+						const sample &s = samples[base + c.sample];
+						if(c.kind == WS_CNTF_BMP085_RAW_ABS) {
+							check_value(r, c.value[0] == s.ut && c.value[1] == s.up);
+						} else if(c.kind == WS_CNTF_SHT1X_ABS) {
+							check_value(r, c.value[0] == s.t && c.value[1] == s.rh);
+						}
+					}
+				}
+			}
+			base += count;
+		}
+	}
+	r.stale = compact.stats().stale;
+	return r;
+}
+
+/* Sync bytes, header, version, node id, batch age and CRC: bytes per datagram that */
+/* carry no sample. The fixed format has the MODE_ID and NULL subheaders instead.  */
+size_t datagram_overhead(int format) {
+	switch(format) {
+	case WS_FORMAT_FIXED:
+		return 4 + 4 + 4 + 4;
+	case WS_FORMAT_COMPACT_V1:
+		return 4 + 4 + 1 + 1 + 2;
+	default:
+		return 4 + 4 + 1 + 1 + 2 + 2;
+	}
+}
+
+} /* namespace */
+
+extern "C" {
+
+int8_t uart_putc(uint8_t c) {
+	wire.push_back(c);
+	return UART_OK;
+}
+
+uint8_t uart_write(const uint8_t *buf, uint8_t len) {
+	wire.insert(wire.end(), buf, buf + len);
+	return len;
+}
+
+uint8_t uart_tx_free(void) {
+	return UART_TX_LEN - 1;
+}
+
+uint16_t timebase_ms(void) {
+	return now_ms;
+}
+
+}
+
+int main(int argc, char **argv) {
+	size_t n = argc > 1 ? strtoul(argv[1], nullptr, 0) : 10000;
+	std::vector<sample> samples = make_samples(n);
+	struct run {
+		const char *name;
+		int format;
+		uint8_t batch;
+	} runs[] = {
+		{"fixed", WS_FORMAT_FIXED, 1},
+		{"compact", WS_FORMAT_COMPACT_V1, 1},
+		{"batch N=1", WS_FORMAT_BATCH_V1, 1},
+		{"batch N=8", WS_FORMAT_BATCH_V1, 8},
+		{"batch N=32", WS_FORMAT_BATCH_V1, 32},
+	};
+	int rc = 0;
+
+	printf("%zu samples at 1/s, sync framing, WS_NTF_MAX_LEN %d, 9600 baud 8N1 = 960 bytes/s\n",
+	       n, WS_NTF_MAX_LEN);
+	printf("payload: share of the bytes on the wire that are sensor records and time stamps\n");
+	printf("%-24s %9s %12s %10s %9s %13s\n", "", "datagrams", "bytes/sample", "vs fixed",
+	       "payload", "samples/s max");
+
+	for(int sht1x = 0; sht1x < 2; sht1x++) {
+		double fixed_bps = 0;
+		for(const run &u : runs) {
+			char name[40];
+
+			wire.clear();
+			ws_ntf_set_format(u.format);
+			ws_ntf_set_batch(u.batch, 32000);
+			send(samples, sht1x);
+			result r = check(samples, 0);
+
+			double bps = double(wire.size()) / n;
+			if(u.format == WS_FORMAT_FIXED) {
+				fixed_bps = bps;
+			}
+			snprintf(name, sizeof(name), "%s %s", sht1x ? "bmp085+sht1x" : "bmp085", u.name);
+			printf("%-24s %9zu %12.2f %9.2fx %8.1f%% %13.1f\n", name, r.datagrams, bps, fixed_bps / bps,
+			       100.0 - 100.0 * r.datagrams * datagram_overhead(u.format) / wire.size(), 960 / bps);
+			if(r.records != n * (sht1x + 1) || r.wrong) {
+				printf("  decoded %zu of %zu records, %zu wrong\n", r.records, n * (sht1x + 1), r.wrong);
+				rc = 1;
+			}
+		}
+	}
+
+	/* Lost datagrams: nothing may be restored wrong */
+	for(const run &u : runs) {
+		if(u.format == WS_FORMAT_FIXED || (u.format == WS_FORMAT_BATCH_V1 && u.batch == 1)) {
+			continue;
+		}
+		wire.clear();
+		ws_ntf_set_format(u.format);
+		ws_ntf_set_batch(u.batch, 32000);
+		send(samples, true);
+		result r = check(samples, 50);
+		printf("%-10s 1 in 50 datagrams lost: %zu records restored, %zu DELTA records skipped, %zu wrong\n",
+		       u.name, r.records, r.stale, r.wrong);
+		if(r.wrong) {
+			rc = 1;
+		}
+	}
+	return rc;
+}
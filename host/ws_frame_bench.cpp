@@ -0,0 +1,100 @@
+/*
+ * Sync byte framing against COBS framing under byte loss
+ *
+ * The same synthetic traffic (ws_synth.cpp) is framed both ways, bytes are
+ * dropped at random and the result is decoded with stream_decoder in 4 KiB
+ * chunks. For every run the decoded datagrams are matched in order against
+ * the ones sent, so a datagram that passes the CRC but was never sent
+ * shows up as a false accept. Exits with 1 if a run without loss does not
+ * decode every datagram.
+ *
+ * Usage: ws_frame_bench [traffic MB]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "ws_decoder.h"
+#include "ws_synth.h"
+
+namespace {
+
+struct result {
+	uint64_t decoded;
+	uint64_t false_accepts;
+	double secs;
+	ws::decoder_stats stats;
+};
+
+result run(const ws_synth::traffic &t, const std::vector<uint8_t> &stream, ws::framing f) {
+	const size_t chunk = 4096;
+	ws::stream_decoder dec(1 << 16, ws::scanner::default_max_data_len, f);
+	ws::datagram d;
+	result r = {};
+	size_t next = 0; /* first sent datagram not matched yet */
+
+	auto t0 = std::chrono::steady_clock::now();
+	for(size_t off = 0; off < stream.size(); off += chunk) {
+		size_t n = stream.size() - off < chunk ? stream.size() - off : chunk;
+		memcpy(dec.write_ptr(), &stream[off], n);
+		dec.commit(n);
+		while(dec.next(d)) {
+			size_t j = next;
+			while(j < t.count() && j < next + 1000 &&
+			      (t.length(j) != d.size() || memcmp(t.datagram(j), d.data(), d.size()) != 0)) {
+				j++;
+			}
+			if(j < t.count() && j < next + 1000) {
+				next = j + 1;
+				r.decoded++;
+			} else {
+				r.false_accepts++;
+			}
+		}
+	}
+	r.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	r.stats = dec.stats();
+	return r;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv) {
+	size_t mb = argc > 1 ? strtoul(argv[1], nullptr, 0) : 16;
+	const double rates[] = { 0, 1e-5, 1e-4, 1e-3, 1e-2 };
+	int fail = 0;
+
+	for(int sync_in_payload = 0; sync_in_payload < 2; sync_in_payload++) {
+		ws_synth::traffic t = ws_synth::make_traffic(mb << 20, sync_in_payload);
+		std::vector<uint8_t> sync_stream = ws_synth::frame_sync(t);
+		std::vector<uint8_t> cobs_stream = ws_synth::frame_cobs(t);
+
+		printf("\n%zu datagrams, %s\n", t.count(),
+		       sync_in_payload ? "sync pattern in every SHT1x record" : "random payload");
+		printf("framing overhead: sync %.2f bytes/datagram, cobs %.2f bytes/datagram\n",
+		       double(sync_stream.size() - t.bytes.size()) / t.count(),
+		       double(cobs_stream.size() - t.bytes.size()) / t.count());
+		printf("%-7s %-5s %10s %10s %12s %8s %10s %9s\n", "loss", "frame", "dropped", "lost dg",
+		       "lost/dropped", "false", "skipped", "MB/s");
+
+		for(double rate : rates) {
+			for(int c = 0; c < 2; c++) {
+				std::vector<uint8_t> s = c ? cobs_stream : sync_stream;
+				size_t dropped = ws_synth::drop_bytes(s, rate, 42);
+				result r = run(t, s, c ? ws::framing::cobs : ws::framing::sync);
+				uint64_t lost = t.count() - r.decoded;
+				printf("%-7g %-5s %10zu %10llu %12.2f %8llu %10llu %9.1f\n", rate, c ? "cobs" : "sync",
+				       dropped, (unsigned long long)lost, dropped ? double(lost) / dropped : 0.0,
+				       (unsigned long long)r.false_accepts, (unsigned long long)r.stats.skipped,
+				       s.size() / r.secs / 1e6);
+				if(rate == 0 && (lost || r.false_accepts)) {
+					fail = 1;
+				}
+			}
+		}
+	}
+	return fail;
+}
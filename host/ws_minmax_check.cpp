@@ -0,0 +1,226 @@
+/*
+ * Min/max check
+ *
+ * Runs the firmware min/max (ws_minmax.c and ws_clock.c built for the host,
+ * timebase_fine() driven by the check) through a few days of samples and
+ * compares every response with a brute force search over all samples: value
+ * and first-seen time of the 24 h and 12 h extremes of both channels. The
+ * run has ties, gaps longer than 12 h and 24 h (with and without samples on
+ * the other channel), a clock that is set late and set again, and a leap day
+ * and a new year. Built once per WS_MINMAX_BUCKET_MIN (see the Makefile).
+ * Exits with 1 on any mismatch.
+ *
+ * Usage: ws_minmax_check
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+extern "C" {
+#include "protocol.h"
+#include "ws_clock.h"
+#include "ws_minmax.h"
+}
+
+namespace {
+
+/* timebase_fine() runs at F_CPU/64 = 156250 counts/s, stepped 200 ms at a time */
+const uint16_t FINE_STEP = 31250;
+const int STEPS_PER_S = 5;
+
+uint16_t fine;
+
+struct sample {
+	uint32_t uptime;
+	uint8_t channel;
+	int16_t temp;
+};
+
+std::vector<sample> samples;
+
+/* Wall clock model: days since 2000-01-01 (a Saturday) */
+bool clock_set;
+int64_t set_wall;       /* Seconds since 2000-01-01 when the clock was set */
+uint32_t set_uptime;    /* ws_clock_uptime() then */
+
+uint32_t rnd = 12345;
+unsigned checks;
+unsigned errors;
+
+uint32_t next_rnd(uint32_t n) {
+	rnd = rnd * 1103515245 + 12345;
+	return (rnd >> 8) % n;
+}
+
+/* Days since 2000-01-01 and back, proleptic Gregorian */
+int64_t days_from_civil(int y, unsigned m, unsigned d) {
+	y -= m <= 2;
+	const int era = (y >= 0 ? y : y - 399) / 400;
+	const unsigned yoe = (unsigned)(y - era * 400);
+	const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+	const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return (int64_t)era * 146097 + doe - 719468 - 10957;
+}
+
+void civil_from_seconds(int64_t s, ws_clock_time_t *t) {
+	int64_t days = (s >= 0 ? s : s - 86399) / 86400;
+	int64_t sod = s - days * 86400;
+	int64_t z = days + 10957 + 719468;
+	const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+	const unsigned doe = (unsigned)(z - era * 146097);
+	const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+	const unsigned mp = (5 * doy + 2) / 153;
+	const unsigned m = mp < 10 ? mp + 3 : mp - 9;
+
+	t->year = (uint16_t)(yoe + era * 400 + (m <= 2));
+	t->month = (uint8_t)m;
+	t->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+	t->weekday = (uint8_t)((days % 7 + 7 + 6) % 7);    /* 0 = Sunday */
+	t->hours = (uint8_t)(sod / 3600);
+	t->minutes = (uint8_t)(sod / 60 % 60);
+	t->seconds = (uint8_t)(sod % 60);
+	t->milliseconds = 0;
+}
+
+void run(uint32_t seconds) {
+	for(uint32_t i = 0; i < seconds * STEPS_PER_S; i++) {
+		fine += FINE_STEP;
+		ws_clock_task();
+	}
+}
+
+void set_clock(int y, unsigned m, unsigned d, unsigned h, unsigned min) {
+	ws_clock_time_t t;
+
+	set_wall = days_from_civil(y, m, d) * 86400 + h * 3600 + min * 60;
+	civil_from_seconds(set_wall, &t);
+	ws_clock_set(&t);
+	set_uptime = ws_clock_uptime();
+	clock_set = true;
+}
+
+/* Brute force entry: extreme of the samples in the last window buckets, the first one on ties */
+min_max_temp_t expected(uint32_t now, uint8_t channel, uint32_t window, bool is_min) {
+	const uint32_t no = now / 60 / WS_MINMAX_BUCKET_MIN;
+	const sample *best = nullptr;
+	min_max_temp_t e = {};
+
+	for(const sample &s : samples) {
+		if(s.channel != channel || s.uptime / 60 / WS_MINMAX_BUCKET_MIN + window <= no) {
+			continue;
+		}
+		if(!best || (is_min ? s.temp < best->temp : s.temp > best->temp)) {
+			best = &s;
+		}
+	}
+	if(!best) {
+		return e;
+	}
+	e.temp = (uint16_t)best->temp;
+	e.valid = 1;
+	if(clock_set) {
+		ws_clock_time_t t;
+
+		civil_from_seconds(set_wall + (int64_t)(best->uptime / 60 * 60) - set_uptime, &t);
+		e.year = t.year;
+		e.month = t.month;
+		e.day = t.day;
+		e.weekday = t.weekday;
+		e.hours = t.hours;
+		e.minutes = t.minutes;
+	}
+	return e;
+}
+
+bool same(const min_max_temp_t &a, const min_max_temp_t &b) {
+	return a.temp == b.temp && a.valid == b.valid && a.year == b.year && a.month == b.month &&
+	       a.day == b.day && a.weekday == b.weekday && a.hours == b.hours && a.minutes == b.minutes;
+}
+
+void check(const char *phase) {
+	static const char *const names[8] = {
+		"max out 24", "min out 24", "max in 24", "min in 24",
+		"max out 12", "min out 12", "max in 12", "min in 12"
+	};
+	const ws_datagram_min_max_resp_t *rsp = ws_minmax_response((uint8_t)checks);
+	const uint32_t now = ws_clock_uptime();
+
+	checks++;
+	for(unsigned i = 0; i < 8; i++) {
+		const uint32_t window = i < 4 ? WS_MINMAX_BUCKETS : WS_MINMAX_BUCKETS / 2;
+		const min_max_temp_t want = expected(now, (i >> 1) & 1, window, i & 1);
+		const min_max_temp_t &got = rsp->minmax_temp[i];
+
+		if(same(got, want)) {
+			continue;
+		}
+		if(errors++ < 10) {
+			printf("%s, uptime %u s, %s: got %d valid %u %04u-%02u-%02u (%u) %02u:%02u,"
+			       " expected %d valid %u %04u-%02u-%02u (%u) %02u:%02u\n",
+			       phase, (unsigned)now, names[i],
+			       (int16_t)got.temp, got.valid, got.year, got.month, got.day, got.weekday,
+			       got.hours, got.minutes,
+			       (int16_t)want.temp, want.valid, want.year, want.month, want.day, want.weekday,
+			       want.hours, want.minutes);
+		}
+	}
+}
+
+/* Samples every 1..max_gap s for the given time. A small value range gives plenty of ties. */
+void samples_for(const char *phase, uint32_t seconds, uint32_t max_gap, bool outdoor, bool indoor) {
+	static int16_t level[WS_MINMAX_CHANNELS] = {50, 210};
+	uint32_t end = ws_clock_uptime() + seconds;
+
+	while(ws_clock_uptime() < end) {
+		uint8_t channel = (uint8_t)next_rnd(2);
+
+		run(1 + next_rnd(max_gap));
+		if(!(channel == WS_MINMAX_OUTDOOR ? outdoor : indoor)) {
+			continue;
+		}
+		level[channel] += (int16_t)next_rnd(5) - 2;
+		samples.push_back({ws_clock_uptime(), channel, level[channel]});
+		ws_minmax_add(channel, level[channel]);
+		check(phase);
+	}
+}
+
+/* No samples at all, a response every 10 min */
+void gap(const char *phase, uint32_t seconds) {
+	for(uint32_t t = 0; t < seconds; t += 600) {
+		run(600);
+		check(phase);
+	}
+}
+
+}
+
+extern "C" uint16_t timebase_fine(void) {
+	return fine;
+}
+
+int main() {
+	ws_minmax_init();
+	check("empty");
+
+	samples_for("clock not set", 30 * 3600, 240, true, true);
+	set_clock(2024, 2, 28, 23, 10);
+	check("clock set");
+	samples_for("leap day", 40 * 3600, 240, true, true);
+	gap("25 h gap", 25 * 3600);
+	samples_for("after 25 h gap", 20 * 3600, 240, true, true);
+	samples_for("indoor only", 13 * 3600, 240, false, true);
+	samples_for("outdoor only", 26 * 3600, 240, true, false);
+	run(37);
+	set_clock(2024, 12, 31, 20, 0);
+	check("clock set again");
+	samples_for("new year", 30 * 3600, 600, true, true);
+	gap("13 h gap", 13 * 3600);
+	samples_for("after 13 h gap", 12 * 3600, 240, true, true);
+
+	printf("ws_minmax_check (%u min buckets): %zu samples, %u responses, %u mismatches\n",
+	       (unsigned)WS_MINMAX_BUCKET_MIN, samples.size(), checks, errors);
+	return errors ? 1 : 0;
+}
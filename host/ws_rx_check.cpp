@@ -0,0 +1,163 @@
+/*
+ * Receiver check
+ *
+ * Runs collector requests through the firmware receiver (ws_rx.c built for
+ * the host, ws_rx_feed() in place of the RX ISR) the way they come over the
+ * line: sync or COBS framed (WS_FRAMING, see the Makefile), starting in the
+ * middle of a frame, with datagrams whose payload was damaged and with line
+ * errors. Every good datagram must come out of ws_rx_get() unchanged and
+ * every bad one must be counted. ACKs (type 0x00, so the first byte of the
+ * datagram is zero) are in the mix on purpose. Exits with 1 on any mismatch.
+ *
+ * Usage: ws_rx_check
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "ws_decoder.h"
+
+extern "C" {
+#include "ws_frame.h"
+#include "ws_rx.h"
+}
+
+namespace {
+
+typedef std::vector<uint8_t> bytes;
+
+void put16(bytes &v, uint16_t x) {
+	v.push_back(x & 0xFF);
+	v.push_back(x >> 8);
+}
+
+/* Header, body and crc of a request. size is the size of the datagram struct. */
+bytes make_request(uint8_t type, uint8_t msg_id, size_t size, uint32_t &rnd) {
+	bytes dg;
+
+	dg.push_back(type);
+	dg.push_back(msg_id);
+	put16(dg, size - sizeof(ws_datagram_header_t));
+	while(dg.size() < size - 2) {
+		rnd = rnd * 1103515245 + 12345;
+		/* Plenty of zeros, they are what COBS has to restore */
+		dg.push_back((rnd >> 16) % 3 == 0 ? 0 : rnd >> 24);
+	}
+	put16(dg, ws::crc16(dg.data(), dg.size()));
+	return dg;
+}
+
+bytes frame(const bytes &dg) {
+	bytes out;
+
+#if WS_FRAMING == WS_FRAMING_COBS
+	out.resize(ws::cobs_max_len(dg.size()) + 1);
+	out.resize(ws::cobs_encode(dg.data(), dg.size(), out.data()));
+	out.push_back(WS_COBS_DELIMITER);
+#else
+	put16(out, USART_SYNC_BYTES & 0xFFFF);
+	put16(out, USART_SYNC_BYTES >> 16);
+	out.insert(out.end(), dg.begin(), dg.end());
+#endif
+	return out;
+}
+
+void feed(const bytes &b) {
+	for(uint8_t c : b) {
+		ws_rx_feed(c, 0);
+	}
+}
+
+struct checker {
+	int failures = 0;
+
+	void expect(bool ok, const char *what, size_t n) {
+		if(!ok) {
+			printf("  FAIL: %s (datagram %zu)\n", what, n);
+			failures++;
+		}
+	}
+
+	/* The next datagram from ws_rx_get() must be dg */
+	bool received(const bytes &dg, size_t n) {
+		uint8_t buf[WS_RX_MAX_LEN];
+		uint8_t len = ws_rx_get(buf);
+		bool ok = len == dg.size() && memcmp(buf, dg.data(), len) == 0;
+		expect(ok, "datagram changed or lost", n);
+		return ok;
+	}
+
+	void empty(size_t n) {
+		uint8_t buf[WS_RX_MAX_LEN];
+		expect(ws_rx_get(buf) == 0, "unexpected datagram", n);
+	}
+};
+
+} /* namespace */
+
+int main() {
+	static const struct {
+		uint8_t type;
+		size_t size;
+	} requests[] = {
+		{WS_DG_TYPE_ACK, sizeof(ws_datagram_ack_t)},
+		{WS_DG_TYPE_TIME_DATE_REQ, sizeof(ws_datagram_time_date_req_t)},
+		{WS_DG_TYPE_TIME_DATE_RSP, sizeof(ws_datagram_time_date_resp_t)},
+		{WS_DG_TYPE_MIN_MAX_REQ, sizeof(ws_datagram_min_max_req_t)},
+		{WS_DG_TYPE_CAL_REQ, sizeof(ws_datagram_cal_req_t)},
+		{WS_DG_TYPE_FORMAT_REQ, sizeof(ws_datagram_format_t)},
+	};
+	const size_t n_requests = sizeof(requests) / sizeof(requests[0]);
+	const size_t count = 20000;
+	uint32_t rnd = 2011;
+	size_t sent = 0, good = 0, bad = 0, acks = 0;
+	checker c;
+
+	ws_rx_init();
+
+	/* Listening starts in the middle of a frame: not an error, nothing received */
+	bytes first = frame(make_request(WS_DG_TYPE_TIME_DATE_REQ, 0, sizeof(ws_datagram_time_date_req_t), rnd));
+	feed(bytes(first.begin() + first.size() / 2, first.end()));
+	c.empty(0);
+	c.expect(ws_rx_errors() == 0, "partial first frame counted as an error", 0);
+
+	for(size_t n = 0; n < count; n++) {
+		const auto &r = requests[n % n_requests];
+		bytes dg = make_request(r.type, n, r.size, rnd);
+
+		if(n % 50 == 25) {
+			/* Payload damaged on the line, the length is still right: a crc error */
+			dg[4 + n % (dg.size() - 4)] ^= 1 << (n % 8);
+			feed(frame(dg));
+			bad++;
+			c.empty(n);
+		} else if(n % 50 == 40) {
+			/* Framing error in the middle of the frame */
+			bytes f = frame(dg);
+			feed(bytes(f.begin(), f.begin() + f.size() / 2));
+			ws_rx_feed(0x55, 1);
+			feed(bytes(f.begin() + f.size() / 2, f.end()));
+			bad++;
+			c.empty(n);
+		} else {
+			feed(frame(dg));
+			sent++;
+			if(c.received(dg, n)) {
+				good++;
+				acks += r.type == WS_DG_TYPE_ACK;
+			}
+		}
+		c.expect(ws_rx_errors() == bad, "error count", n);
+	}
+
+	/* A full queue drops good datagrams and counts them */
+	for(size_t n = 0; n < WS_RX_QUEUE; n++) {
+		feed(frame(make_request(WS_DG_TYPE_ACK, n, sizeof(ws_datagram_ack_t), rnd)));
+	}
+	c.expect(ws_rx_dropped() == 1, "dropped count", count);
+
+	printf("%s framing: %zu of %zu datagrams received (%zu ACKs), %u of %zu errors counted, %u dropped\n",
+	       WS_FRAMING == WS_FRAMING_COBS ? "COBS" : "sync", good, sent, acks, ws_rx_errors(), bad, ws_rx_dropped());
+	return c.failures ? 1 : 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * SHT1x conversion and checksum check
+ *
+ * Runs the firmware conversion (sht1x-calc.c built for the host) over
+ * every temperature and humidity reading of both resolutions and compares
+ * it with the datasheet formulas in double, each resolution with its own
+ * coefficient set:
+ *  - temperature d1 + d2 * SOt must come out exact (0.01 degC)
+ *  - humidity c1 + c2 * SOrh + c3 * SOrh^2 + (T - 25) * (t1 + t2 * SOrh),
+ *    limited to 0..100 %RH, must be within 0.0075 %RH
+ * Then checks the CRC-8:
+ *  - the byte table and nibble table updates against the bitwise CRC-8
+ *    for every start value and byte
+ *  - sht1x_crc_ok() for every status nibble, command and data, with the
+ *    right checksum and with every single bit error in it
+ *  - a fixed command/data/checksum vector
+ * Exits with 1 if one is off.
+ *
+ * Usage: ws_sht1x_check
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+
+extern "C" {
+#include "protocol.h"
+#include "sht1x-calc.h"
+}
+
+namespace {
+
+/* Datasheet coefficients per resolution (SHT1X_RES_14_12, SHT1X_RES_12_8) */
+struct coefficients {
+	const char *name;
+	unsigned t_max, rh_max;    /* Largest raw readings */
+	double d2;
+	double c1, c2, c3;
+	double t1, t2;
+};
+
+const coefficients res[2] = {
+	{ "14/12 bit", 16383, 4095, 0.01, -2.0468, 0.0367, -1.5955E-6, 0.01, 0.00008 },
+	{ "12/8 bit", 4095, 255, 0.04, -2.0468, 0.5872, -4.0845E-4, 0.01, 0.00128 },
+};
+
+const double rh_bound = 0.0075;
+
+/* Commands with the number of data bytes that follow them */
+struct command {
+	uint8_t cmd;
+	uint8_t len;
+};
+
+const command commands[] = {
+	{ 0x03, 2 },    /* Measure temperature */
+	{ 0x05, 2 },    /* Measure humidity */
+	{ 0x07, 1 },    /* Read status register */
+};
+
+double temperature(const coefficients &k, unsigned so) {
+	return SHT1X_D1 / 100.0 + k.d2 * so;
+}
+
+double humidity(const coefficients &k, unsigned so_t, unsigned so_rh) {
+	double rh = k.c1 + k.c2 * so_rh + k.c3 * so_rh * so_rh;
+
+	rh += (temperature(k, so_t) - 25) * (k.t1 + k.t2 * so_rh);
+	return std::fmin(std::fmax(rh, 0.0), 100.0);
+}
+
+/* The definition: x^8 + x^5 + x^4 + 1, MSB first, one bit at a time */
+uint8_t crc_bitwise(uint8_t crc, uint8_t data) {
+	crc ^= data;
+	for(int b = 0; b < 8; b++) {
+		crc = (crc & 0x80) ? (crc << 1) ^ 0x31 : crc << 1;
+	}
+	return crc;
+}
+
+/* The checksum the sensor sends: bit reversed status nibble as start value, */
+/* command and data, result bit reversed. Written out without sht1x-calc.c.  */
+uint8_t crc_sensor(uint8_t status, uint8_t cmd, const uint8_t *data, uint8_t len) {
+	uint8_t crc = 0, out = 0;
+
+	for(int b = 0; b < 4; b++) {
+		crc |= ((status >> b) & 1) << (7 - b);
+	}
+	crc = crc_bitwise(crc, cmd);
+	for(uint8_t i = 0; i < len; i++) {
+		crc = crc_bitwise(crc, data[i]);
+	}
+	for(int b = 0; b < 8; b++) {
+		out |= ((crc >> b) & 1) << (7 - b);
+	}
+	return out;
+}
+
+int check_conversion() {
+	int rc = 0;
+
+	for(uint8_t r = 0; r < 2; r++) {
+		const coefficients &k = res[r];
+		ws_sensor_sht1x_t s = {};
+		unsigned t_errors = 0;
+		double rh_max = 0;
+		unsigned at_t = 0, at_rh = 0;
+
+		s.resolution_setting = r;
+		for(unsigned so_t = 0; so_t <= k.t_max; so_t++) {
+			s.temperature = so_t;
+			s.humidity = 0;
+			if(sht1x_calc_temperature(&s) != std::lround(temperature(k, so_t) * 100)) {
+				t_errors++;
+			}
+			for(unsigned so_rh = 0; so_rh <= k.rh_max; so_rh++) {
+				s.humidity = so_rh;
+				double e = std::fabs(sht1x_calc_humidity(&s) / 100.0 - humidity(k, so_t, so_rh));
+				if(e > rh_max) {
+					rh_max = e;
+					at_t = so_t;
+					at_rh = so_rh;
+				}
+			}
+		}
+		printf("%-9s  temperature: %u of %u off, humidity: max error %.4f %%RH at SOt %u, SOrh %u\n",
+		       k.name, t_errors, k.t_max + 1, rh_max, at_t, at_rh);
+		if(t_errors || rh_max > rh_bound) {
+			rc = 1;
+		}
+	}
+	return rc;
+}
+
+int check_crc() {
+	unsigned table_errors = 0, ok_errors = 0, vectors = 0;
+
+	for(unsigned crc = 0; crc < 256; crc++) {
+		for(unsigned b = 0; b < 256; b++) {
+			uint8_t ref = crc_bitwise(crc, b);
+			table_errors += sht1x_crc_update_byte(crc, b) != ref;
+			table_errors += sht1x_crc_update_nibble(crc, b) != ref;
+		}
+	}
+
+	for(uint8_t status = 0; status < 16; status++) {
+		for(const command &c : commands) {
+			for(unsigned v = 0; v < (1u << (8 * c.len)); v++) {
+				uint8_t data[3] = { (uint8_t)(v >> 8), (uint8_t)v, 0 };
+				uint8_t *d = c.len == 1 ? data + 1 : data;
+
+				d[c.len] = crc_sensor(status, c.cmd, d, c.len);
+				ok_errors += !sht1x_crc_ok(status, c.cmd, d, c.len);
+				vectors++;
+				for(int b = 0; b < 8; b++) {
+					d[c.len] ^= 1 << b;
+					ok_errors += sht1x_crc_ok(status, c.cmd, d, c.len);
+					d[c.len] ^= 1 << b;
+				}
+			}
+		}
+	}
+
+	/* Humidity reading 0x0931 with the default status register. The checksum 0x1A is */
+	/* the datasheet procedure done one bit at a time, not a value quoted by Sensirion. */
+	const uint8_t rh[3] = { 0x09, 0x31, 0x1A };
+	bool fixed = sht1x_crc_ok(0x00, 0x05, rh, 2) && crc_sensor(0x00, 0x05, rh, 2) == rh[2];
+
+	printf("crc-8      tables: %u of %u updates off, sht1x_crc_ok(): %u of %u readings wrong, "
+	       "fixed vector %s\n", table_errors, 2 * 256 * 256, ok_errors, vectors, fixed ? "ok" : "FAILED");
+	return table_errors || ok_errors || !fixed;
+}
+
+} /* namespace */
+
+int main() {
+	int rc = check_conversion();
+
+	if(check_crc()) {
+		rc = 1;
+	}
+	return rc;
+}
@@ -0,0 +1,143 @@
+/*
+ * Synthetic weather station traffic for the benchmarks
+ */
+
+#include <cstring>
+
+#include "ws_decoder.h"
+#include "ws_synth.h"
+
+namespace ws_synth {
+
+namespace {
+
+void put16(std::vector<uint8_t> &v, uint16_t x) {
+	v.push_back(x & 0xFF);
+	v.push_back(x >> 8);
+}
+
+void put_subheader(std::vector<uint8_t> &v, uint16_t id, uint16_t data) {
+	put16(v, id);
+	put16(v, data);
+}
+
+template <typename T>
+void put_record(std::vector<uint8_t> &v, const T &rec) {
+	const uint8_t *p = reinterpret_cast<const uint8_t *>(&rec);
+	v.insert(v.end(), p, p + sizeof(rec));
+}
+
+/* Appends a datagram. body is everything after the header up to the */
+/* two CRC bytes, which are appended here.                           */
+void put_datagram(traffic &t, uint8_t type, uint8_t msg_id, const std::vector<uint8_t> &body) {
+	size_t start = t.bytes.size();
+
+	t.bytes.push_back(type);
+	t.bytes.push_back(msg_id);
+	put16(t.bytes, body.size() + 2);
+	t.bytes.insert(t.bytes.end(), body.begin(), body.end());
+	put16(t.bytes, ws::crc16(&t.bytes[start], t.bytes.size() - start));
+	t.offsets.push_back(t.bytes.size());
+}
+
+} /* namespace */
+
+traffic make_traffic(size_t target_bytes, bool sync_in_payload) {
+	traffic t;
+	std::vector<uint8_t> body;
+	ws_sensor_bmp085_raw_t raw;
+	ws_sensor_bmp085_cal_t cal;
+	ws_sensor_sht1x_t sht;
+	uint32_t rnd = 12345;
+	uint8_t msg_id = 0;
+	uint32_t n = 0;
+
+	memset(&raw, 0, sizeof(raw));
+	memset(&cal, 0, sizeof(cal));
+	memset(&sht, 0, sizeof(sht));
+	cal.ac1 = 408; cal.ac2 = -72; cal.ac3 = -14383; cal.ac4 = 32741; cal.ac5 = 32757;
+	cal.ac6 = 23153; cal.b1 = 6190; cal.b2 = 4; cal.mb = -32768; cal.mc = -8711; cal.md = 2868;
+	cal.cal_tag = 0x5A;
+	t.bytes.reserve(target_bytes + 256);
+	t.offsets.push_back(0);
+
+	while(t.bytes.size() < target_bytes) {
+		rnd = rnd * 1103515245 + 12345;
+		body.clear();
+		if(n % 32 == 31) {
+			body.assign(2, 0);
+			put_datagram(t, WS_DG_TYPE_ACK, msg_id++, body);
+		} else {
+			put_subheader(body, WS_SENSOR_NTF_MODE_ID, WS_NODE_ID_MAIN_UNIT);
+			if(n % 100 == 0) {
+				put_subheader(body, WS_SENSOR_NTF_BMP085_CAL, 0);
+				put_record(body, cal);
+			}
+			raw.temperature = 27898 + (rnd & 0xFF);
+			raw.pressure = 23843 + (rnd >> 20);
+			raw.cal_tag = 0x5A;
+			put_subheader(body, WS_SENSOR_NTF_BMP085_RAW, 0);
+			put_record(body, raw);
+			if(n % 4 == 0) {
+				if(sync_in_payload) {
+					sht.temperature = USART_SYNC_BYTES & 0xFFFF;
+					sht.humidity = USART_SYNC_BYTES >> 16;
+				} else {
+					sht.temperature = 6000 + (rnd & 0x3FF);
+					sht.humidity = 1500 + (rnd >> 22);
+				}
+				put_subheader(body, WS_SENSOR_NTF_SHT1X, 0);
+				put_record(body, sht);
+			}
+			put_subheader(body, WS_SENSOR_NFT_NULL, 0);
+			body.resize(body.size() - 2); /* crc goes in the NULL data field */
+			put_datagram(t, WS_DG_TYPE_SENSOR_DATA_NTF, msg_id++, body);
+		}
+		n++;
+	}
+	return t;
+}
+
+std::vector<uint8_t> frame_sync(const traffic &t) {
+	std::vector<uint8_t> out;
+
+	out.reserve(t.bytes.size() + 4 * t.count());
+	for(size_t i = 0; i < t.count(); i++) {
+		put16(out, USART_SYNC_BYTES & 0xFFFF);
+		put16(out, USART_SYNC_BYTES >> 16);
+		out.insert(out.end(), t.datagram(i), t.datagram(i) + t.length(i));
+	}
+	return out;
+}
+
+std::vector<uint8_t> frame_cobs(const traffic &t) {
+	std::vector<uint8_t> out(t.bytes.size() + 3 * t.count());
+	size_t o = 0;
+
+	for(size_t i = 0; i < t.count(); i++) {
+		if(out.size() < o + ws::cobs_max_len(t.length(i)) + 1) {
+			out.resize(out.size() * 2);
+		}
+		o += ws::cobs_encode(t.datagram(i), t.length(i), &out[o]);
+		out[o++] = WS_COBS_DELIMITER;
+	}
+	out.resize(o);
+	return out;
+}
+
+size_t drop_bytes(std::vector<uint8_t> &stream, double rate, uint32_t seed) {
+	uint64_t limit = uint64_t(rate * 4294967296.0);
+	size_t o = 0;
+
+	for(size_t i = 0; i < stream.size(); i++) {
+		seed = seed * 1664525 + 1013904223;
+		if(seed >= limit) {
+			stream[o++] = stream[i];
+		}
+	}
+	size_t dropped = stream.size() - o;
+	stream.resize(o);
+	return dropped;
+}
+
+} /* namespace ws_synth */
@@ -0,0 +1,40 @@
+/*
+ * Synthetic weather station traffic for the benchmarks
+ */
+
+#ifndef _WS_SYNTH_H_
+#define _WS_SYNTH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ws_synth {
+
+/* Datagrams (header to crc, no framing) back to back. */
+/* Datagram i is bytes [offsets[i], offsets[i + 1]).   */
+struct traffic {
+	std::vector<uint8_t> bytes;
+	std::vector<size_t> offsets;
+
+	size_t count() const { return offsets.size() - 1; }
+	const uint8_t *datagram(size_t i) const { return &bytes[offsets[i]]; }
+	size_t length(size_t i) const { return offsets[i + 1] - offsets[i]; }
+};
+
+/* Roughly the traffic of a main unit: mostly BMP085 raw readings, an    */
+/* SHT1x reading in every fourth datagram, calibration now and then and */
+/* acks. With sync_in_payload every SHT1x record contains the sync      */
+/* pattern (temperature 0x5678, humidity 0x1234).                       */
+traffic make_traffic(size_t target_bytes, bool sync_in_payload = false);
+
+/* Framed byte streams */
+std::vector<uint8_t> frame_sync(const traffic &t);
+std::vector<uint8_t> frame_cobs(const traffic &t);
+
+/* Removes each byte with probability rate. Returns the number removed. */
+size_t drop_bytes(std::vector<uint8_t> &stream, double rate, uint32_t seed);
+
+} /* namespace ws_synth */
+
+#endif